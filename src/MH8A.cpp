@@ -1,199 +1,509 @@
 #include <Arduino.h>
+#include <LittleFS.h>
+#include <atomic>
 #include "MH8A.h"
 #include "main.h"
+#include "web.h"
 #include "display.h"
+#include "decoder.h"
+#include "capture.h"
+#include "transmitters.h"
+#include "flashlog.h"
+#include "timekeeping.h"
+#include "metrics.h"
+#include "trace.h"
 
-#define TIME_MIN_0 800       // us
-#define TIME_MAX_0 1200      // us
-#define TIME_MIN_1 1800      // us
-#define TIME_MAX_1 2200      // us
-#define TIME_END_FRAME 15000 // us
-#define TIMEOUT 8000000      // us
+#define TIMEOUT 8000000 // us
 
-#define INT_PIN_RECEIVER 4 // GPIO4
+#define DECODER_MODE decoderAdaptive // decoderFixed to use only TIME_MIN_x / TIME_MAX_x
 
-// Shared variable between interrupt and main code
-volatile long LastTime = 0;
-volatile char bufferReception[64] = {0};
+#define TANK_DISPLAY_TIME 3000 // ms - time each tank is displayed when several are in range
 
-String frame = "";
+// Readings are written to the flash by blocks, to limit the wear and the power spent
+#define LOG_DIR "/littlefs/log"
+#define LOG_FLUSH_READINGS 128 // Readings waiting in RTC memory before a write
+#define HISTORY_MAGIC 0x4D483841 // "MH8A" - history and loggedNum written by this firmware
+
+// Capture and decoding run on their own task, on the other core than loop()
+#define DECODE_TASK_CORE 0
+#define DECODE_TASK_PRIORITY 10
+#define DECODE_TASK_STACK 4096 // bytes
+#define DECODE_QUEUE_LENGTH 8  // events
+
+// Messages sent to the USB by a low priority task, on the core of the decoding task
+#define TRACE_TASK_PRIORITY 1
+#define TRACE_TASK_STACK 3072 // bytes
+#define TRACE_TASK_PERIOD 20  // ms
+
+typedef enum
+{
+    eventFrame = 0, // Valid frame
+    eventReject,    // Burst without any valid frame
+    eventError,     // Frame with a valid ID but a wrong checksum
+    eventNoComm,    // Nothing received during TIMEOUT
+} tEventType;
+
+// State of the decoder copied by the decoding task : loop() never reads the decoder of the other core
+typedef struct
+{
+    tDecoderStats Stream;
+    tDecoderStats Gap;
+    uint16_t Min0, Max0, Min1, Max1; // us - windows of the bits
+    uint32_t Overflow;               // Pulses lost by the capture
+} tDecoderReport;
+
+// Sent by the decoding task to loop()
+typedef struct
+{
+    tEventType Type;
+    union
+    {
+        tFrame Frame;          // eventFrame, eventError
+        tDecoderReport Report; // eventNoComm
+    };
+    tReject Reason;
+    int Length;
+    long Time; // us
+} tDecoderEvent;
+
+// Frames are decoded by the decoding task from the received pulses, only this task uses the decoder
+tStreamDecoder streamDecoder;
+std::atomic<int> burstLength(0); // Bits of the burst being received, published for loop()
+
+TaskHandle_t decodeTask = NULL;
+TaskHandle_t loopTask = NULL; // Woken up by each event
+QueueHandle_t decodeQueue = NULL;
+uint32_t decodeQueueFull = 0;
+volatile unsigned long decodeMaxLoop = 0; // us
+
+// Tank displayed in the main zone, it is not replaced by the other ones when pinned
+uint32_t tankId = 0;
+bool tankPinned = false;
+unsigned long tankMillis = 0;
 
 // Section of memory saved during deep sleep of ESP32
-RTC_DATA_ATTR uint64_t timestamp = 0;
-RTC_DATA_ATTR tHistory history[HISTORY_LENGTH];
-RTC_DATA_ATTR int historyIndex = 0;
-
-// Sinusoid 38khz during 1ms + Short pause 1ms is a 0
-// sinusoid 38khz during 1ms + long pause 2ms is a 1
-// Purpose is to measure the time between the last high level and then to wait the pause to get the next high level
-// 0 is then 1ms sinusoid + 1 ms pause
-// and 1 is 1ms sinusoid + 2ms pause
-void IRAM_ATTR ProcessIntPin()
-{
-    long Time = micros();
-    long Delta = Time - LastTime;
-
-    LastTime = Time;
-
-    if ((Delta > TIME_MIN_0) && (Delta < TIME_MAX_0))
-        bufferReception[strlen((char *)bufferReception)] = '0';
-    if ((Delta > TIME_MIN_1) && (Delta < TIME_MAX_1))
-        bufferReception[strlen((char *)bufferReception)] = '1';
-}
-
-// For tank ID, the protocol is using a dedicated coding for each number
-// This function will replace the 4 bits of each digit by its integer value
-inline String GetChar(String s)
-{
-    if (s == "1010")
-        return "0";
-    else if (s == "1011")
-        return "1";
-    else if (s == "1100")
-        return "2";
-    else if (s == "0011")
-        return "3";
-    else if (s == "1101")
-        return "4";
-    else if (s == "0101")
-        return "5";
-    else if (s == "0110")
-        return "6";
-    else if (s == "0111")
-        return "7";
-    else if (s == "1110")
-        return "8";
-    else if (s == "1001")
-        return "9";
+// The history is also kept by the resets that do not cut the power (panic, watchdog) : not initialized
+RTC_NOINIT_ATTR tHistory history;
+RTC_NOINIT_ATTR uint32_t loggedNum; // Next reading to write to the flash log
+RTC_NOINIT_ATTR uint32_t historyMagic;
+RTC_DATA_ATTR float reservePressure = RESERVE_PRESSURE; // bar
+RTC_DATA_ATTR int traceVerbosity = traceDebug;
+
+// Messages of the decoding path, loop() never waits for the USB
+tTraceRing traceRing;
+TaskHandle_t traceTask = NULL;
+
+// Last pause of the frame displayed, waiting for the screen to be sent - us
+unsigned long latencyStart = 0;
+bool latencyPending = false;
+
+// Long-term history in the flash, only opened when needed
+tLog flashLog;
+
+// Message added to the ring without waiting, the time spent is counted
+// Only called from loop() and setup() : single producer of the ring
+void Trace(tTraceType type, uint32_t time, std::initializer_list<uint32_t> args)
+{
+    uint32_t Cycles = ESP.getCycleCount();
+    tTraceRecord *Record = newTrace(&traceRing, type, time);
+
+    if (Record)
+    {
+        int i = 0;
+        for (uint32_t Arg : args)
+            if (i < TRACE_ARGS)
+                Record->Args[i++] = Arg;
+        commitTrace(&traceRing);
+    }
+
+    countMetric(metricLogCycles, ESP.getCycleCount() - Cycles);
+}
+
+// Records formatted and sent to the USB, dropped when the host does not read them
+void TraceTask(void *)
+{
+    tTraceRecord Record;
+    char Text[TRACE_TEXT];
+
+    for (;;)
+    {
+        while (popTrace(&traceRing, &Record))
+        {
+            int Length = formatTrace(&Record, Text, sizeof(Text));
+
+            if (Serial && (Serial.availableForWrite() >= Length))
+                Serial.write((const uint8_t *)Text, Length);
+            else
+                traceRing.Unsent.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        vTaskDelay(pdMS_TO_TICKS(TRACE_TASK_PERIOD));
+    }
+}
+
+bool mountLog()
+{
+    if (flashLog.Open)
+        return true;
+
+    if (!LittleFS.begin(true))
+        return false;
+
+    openLog(&flashLog, LOG_DIR);
+    if (flashLog.Recovered)
+        Trace(traceLogRecovered, micros(), {flashLog.Recovered});
+
+    return true;
+}
+
+// Start without deep sleep : the numbers of the readings continue after the ones already in the flash
+// The readings kept in RTC memory by a reset and not written yet are written first
+void initLog(bool powerOn)
+{
+    if (powerOn || (historyMagic != HISTORY_MAGIC) || (loggedNum > history.Count))
+    {
+        resumeHistory(&history, 0);
+        loggedNum = 0;
+        historyMagic = HISTORY_MAGIC;
+    }
+
+    if (!mountLog())
+        return;
+
+    flushLog(true);
+
+    resumeHistory(&history, nextLogNum(&flashLog));
+    loggedNum = history.Count;
+}
+
+void flushLog(bool force)
+{
+    if (history.Count - loggedNum < (force ? 1 : LOG_FLUSH_READINGS))
+        return;
+
+    if (!mountLog())
+        return;
+
+    unsigned long Start = micros();
+    uint32_t From = max(loggedNum, historyOldest(&history));
+    int Nb = appendLog(&flashLog, &history, From);
+    loggedNum = From + Nb;
+
+    Trace(traceLogWritten, Start, {(uint32_t)Nb, (uint32_t)(micros() - Start)});
+}
+
+void DisplayTank(const tTransmitter *t)
+{
+    float Bar = t->Pressure * 2 / 14.504;
+    float Reserve = timeToReserve(&t->Consumption, Bar, reservePressure);
+
+    // '~' after P : the last frame has been corrected, the pressure may be wrong
+    // Battery of the transmitter is only displayed when it is not good or when the consumption is not known yet
+    if ((t->Battery != batteryGood) || (t->Consumption.Trend <= 0))
+        displayText(main, 2,
+                    "ID%c %06u\nP%c %.2f\nB : %s",
+                    tankPinned ? '*' : ':', (unsigned)t->Id, t->Corrected ? '~' : ':', Bar, batteryText(t->Battery));
+    else if (Reserve < 0)
+        displayText(main, 2,
+                    "ID%c %06u\nP%c %.2f\n%.1fb/mn",
+                    tankPinned ? '*' : ':', (unsigned)t->Id, t->Corrected ? '~' : ':', Bar, t->Consumption.Trend);
     else
-        return "!";
+        displayText(main, 2,
+                    "ID%c %06u\nP%c %.2f\n%.1fb %dmn",
+                    tankPinned ? '*' : ':', (unsigned)t->Id, t->Corrected ? '~' : ':', Bar, t->Consumption.Trend, (int)Reserve);
+
+    tankId = t->Id;
+    tankMillis = millis();
 }
 
-// This function will decode the frame that has been received
-void Decode(String frameToBeDecoded, int time)
+void pinTank()
 {
-    // Display the raw frame
-    // Serial.println(frameToBeDecoded);
+    tTransmitter *t = findTransmitter(tankId);
 
-    // If length is not the good one, exit
-    if (frameToBeDecoded.length() != 58)
+    // Tank removed from the table : nothing to pin
+    if (t == nullptr)
     {
-        Serial.printf("NOK %d\n", frameToBeDecoded.length());
+        tankPinned = false;
         return;
     }
 
-    // Get the different parts of the frame
-    String Preamble = frameToBeDecoded.substring(0, 2);
-    String Sync1 = frameToBeDecoded.substring(2, 6);
-    String Sync2 = frameToBeDecoded.substring(6, 10);
+    tankPinned = !tankPinned;
+    DisplayTank(t);
+}
 
-    // For ID, 6 digits to be replace with the lookup table
-    String ID = "";
-    for (int i = 0; i < 6; i++)
-        ID += GetChar(frameToBeDecoded.substring(10 + i * 4, 10 + 4 + i * 4));
+// This function will display and store the frame that has been received
+void Decode(const tFrame *Frame, int time)
+{
+    // Print all data
+    Trace(traceFrame, time, {Frame->IdNumber, (uint32_t)Frame->Pressure, (uint32_t)Frame->Battery, Frame->ChecksumOk, Frame->Corrected});
 
-    // Pressure is encoded in PSI - 12bits
-    // The value in the frame is half of the real value
-    int Pressure = std::stoi(frameToBeDecoded.substring(34, 46).c_str(), nullptr, 2);
+    // Time of the capture of the frame, in the time base of millis() : loop() may have slept since then
+    uint32_t captured = millis() - (uint32_t)(micros() - time) / 1000;
 
-    // Battery status can be Good, Low, Critical with a specific coding
-    String Batt = frameToBeDecoded.substring(46, 50);
-    Batt = (Batt == "0000") ? "Good" : (Batt == "0010") ? "Low"
-                                   : (Batt == "0001")   ? "Critical"
-                                                        : "Unknown";
+    // Print data on SSD1306 screen, unless another tank is pinned
+    tTransmitter *Tank = updateTransmitter(Frame, captured);
 
-    // Checksum is calculated as following :
-    // Remove the 2 first bits (Preamble)
-    // Add the integer value of each 4 bits (12 nibbles)
-    int ChecksumCalc = 0;
-    for (int i = 0; i < 12; i++)
-        ChecksumCalc += std::stoi(frameToBeDecoded.substring(2 + i * 4, 2 + 4 + i * 4).c_str(), nullptr, 2);
+    // The pinned tank may have been removed to make room for this one
+    if (tankPinned && (findTransmitter(tankId) == nullptr))
+        tankPinned = false;
 
-    // Checksum is located in the 8 last bits of the frame
-    int ChesumMsg = std::stoi(frameToBeDecoded.substring(50, 58).c_str(), nullptr, 2);
+    if (!tankPinned || (Tank->Id == tankId))
+    {
+        DisplayTank(Tank);
+        latencyStart = time;
+        latencyPending = true;
+    }
 
-    // Print all data
-    Serial.printf("Time : %.1f, ", float(time) / 1000000);
-    Serial.printf("ID : %s, ", ID.c_str());
-    Serial.printf("Pressure : %d PSI - %.2f bars, ", Pressure * 2, Pressure * 2 / 14.504);
-    Serial.printf("Battery : %s, ", Batt.c_str());
-    Serial.printf("Checksum : %s\n", (ChecksumCalc == ChesumMsg) ? "OK" : "NOK");
-    Serial.flush();
-
-    // Print data on SSD1306 screen
-    if (ChecksumCalc == ChesumMsg)
+    time_t now = clockNow();
+    uint32_t num = addHistory(&history, now, Frame);
+
+    // Pushed to the browsers connected
+    publishWeb(num, time);
+
+    // Update the live indicator & time
+    LiveIndicatorAndTime();
+    razTimerGoToSleep();
+}
+
+// Called by the decoding task : never waits for loop(), the event is lost if the queue is full
+void PostEvent(const tDecoderEvent *event)
+{
+    if (event->Type == eventFrame)
+        countMetric(metricFrames);
+
+    if (xQueueSend(decodeQueue, event, 0) != pdTRUE)
     {
-        displayText(main, 2,
-                    "ID: %s\nP : %.2f\nB : %s",
-                    ID.c_str(), Pressure * 2 / 14.504, Batt.c_str());
+        decodeQueueFull++;
+        countMetric(metricEventsLost);
+    }
+    else if (loopTask)
+        xTaskNotifyGive(loopTask);
+}
 
-        time_t now = timestamp + micros() / 1000000;
-        struct tm t;
-        localtime_r(&now, &t);
+void SendEvent(tEventType type, const tFrame *frame, tReject reason, int length, long time)
+{
+    tDecoderEvent Event;
+
+    Event.Type = type;
+    if (frame)
+        Event.Frame = *frame;
+    Event.Reason = reason;
+    Event.Length = length;
+    Event.Time = time;
 
-        unsigned char index = historyIndex % HISTORY_LENGTH;
+    PostEvent(&Event);
+}
 
-        history[index].num = historyIndex;
-        strcpy(history[index].ID, ID.c_str());
-        history[index].Pressure = Pressure;
-        strcpy(history[index].Battery, Batt.c_str());
+// Statistics and windows of the decoder, traced by loop()
+void SendNoComm(long time)
+{
+    tDecoderEvent Event;
+
+    Event.Type = eventNoComm;
+    Event.Report.Stream = streamDecoder.Stream;
+    Event.Report.Gap = streamDecoder.Gap;
+    Event.Report.Min0 = streamDecoder.Timing.Min0;
+    Event.Report.Max0 = streamDecoder.Timing.Max0;
+    Event.Report.Min1 = streamDecoder.Timing.Min1;
+    Event.Report.Max1 = streamDecoder.Timing.Max1;
+    Event.Report.Overflow = captureOverflow();
+    Event.Reason = rejectLength;
+    Event.Length = 0;
+    Event.Time = time;
+
+    PostEvent(&Event);
+}
 
-        history[index].time = t;
+// Pauses classified by the decoder since the last call added to the metrics
+void SyncMetrics()
+{
+    static uint32_t Symbols[2] = {0, 0};
+    static uint32_t OutOfWindow = 0;
+    static uint32_t Refused = 0;
+
+    countMetric(metricSymbol0, streamDecoder.Symbols[0] - Symbols[0]);
+    countMetric(metricSymbol1, streamDecoder.Symbols[1] - Symbols[1]);
+    countMetric(metricOutOfWindow, streamDecoder.OutOfWindow - OutOfWindow);
+    countMetric(metricRefused, streamDecoder.Stream.Refused - Refused);
+
+    Symbols[0] = streamDecoder.Symbols[0];
+    Symbols[1] = streamDecoder.Symbols[1];
+    OutOfWindow = streamDecoder.OutOfWindow;
+    Refused = streamDecoder.Stream.Refused;
+}
 
-        historyIndex++;
+// Convert the pulses received by the capture into bits, frames are decoded as soon as they are complete
+void ReadPulses()
+{
+    uint16_t Delta;
+    tFrame Frame;
 
-        // Update the live indicator & time
-        LiveIndicatorAndTime();
-        razTimerGoToSleep();
+    while (readPulse(&Delta))
+        if (streamPulse(&streamDecoder, Delta, &Frame))
+            SendEvent(eventFrame, &Frame, rejectLength, FRAME_LENGTH, lastEdgeTime());
+}
+
+void DecodeTask(void *)
+{
+    bool NoComm = false;
+    unsigned long LastLoop = micros();
+
+    // The interrupt of the capture is attached on the core of this task
+    initCapture();
+    bootPhase(bootCapture);
+
+    for (;;)
+    {
+        ReadPulses();
+        SyncMetrics();
+
+        // Read after the pulses so that the last pulse of the frame is always taken into account
+        long TimeFrame = micros();
+
+        // No high value during long time -> end of frame
+        if ((TimeFrame - lastEdgeTime() > TIME_END_FRAME) && (streamDecoder.Burst.Length > 0))
+        {
+            tReject Reason;
+            tFrame Frame;
+            int Length = streamDecoder.Burst.Length;
+
+            // Comm active as we received a frame
+            NoComm = false;
+
+            // Burst decoded again with the windows of each transmitter
+            if (streamRetime(&streamDecoder, &Frame))
+                SendEvent(eventFrame, &Frame, rejectLength, FRAME_LENGTH, lastEdgeTime());
+            // Last chance for a frame with a wrong checksum
+            else if (streamCorrect(&streamDecoder, &Frame))
+            {
+                countMetric(metricCorrected);
+                SendEvent(eventFrame, &Frame, rejectLength, FRAME_LENGTH, lastEdgeTime());
+            }
+            else if (decodeFrame(streamDecoder.Window.Bits, streamDecoder.Window.Length, &Frame) && Frame.IdValid)
+                SendEvent(eventError, &Frame, rejectChecksum, FRAME_LENGTH, lastEdgeTime());
+
+            // The frame has already been sent if it was valid
+            if (!streamEndOfFrame(&streamDecoder, &Reason))
+            {
+                countMetric((tCounter)(metricRejectLength + Reason));
+                SendEvent(eventReject, NULL, Reason, Length, lastEdgeTime());
+            }
+        }
+
+        // After the events of the burst : loop() sees them in the queue when the burst is over
+        burstLength.store(streamDecoder.Burst.Length, std::memory_order_release);
+
+        // No high value during a longer time -> no more communication
+        if ((TimeFrame - lastEdgeTime() > TIMEOUT) && (NoComm == false))
+        {
+            flushCapture();
+            SendNoComm(TimeFrame);
+            NoComm = true;
+        }
+
+        // Longest time between 2 readings of the pulses, reset by the report of loop()
+        unsigned long Now = micros();
+        if (Now - LastLoop > decodeMaxLoop)
+            decodeMaxLoop = Now - LastLoop;
+        LastLoop = Now;
+
+        // A frame is ~150 ms long and the capture buffers 256 pauses : 1 tick is enough
+        vTaskDelay(1);
     }
 }
 
-void EmptyBuffer()
+void frameOnScreen()
+{
+    if (latencyPending)
+        observeMetric(histogramLatency, micros() - latencyStart);
+    latencyPending = false;
+}
+
+void decodeTaskStats(unsigned *stackFree, unsigned long *maxLoop, unsigned *queueFull)
+{
+    *stackFree = decodeTask ? uxTaskGetStackHighWaterMark(decodeTask) : 0;
+    *maxLoop = decodeMaxLoop;
+    *queueFull = decodeQueueFull;
+    decodeMaxLoop = 0;
+}
+
+// Decoder : 0 stream, 1 gap
+void PrintStats(uint32_t decoder, const tDecoderStats *stats, long time)
 {
-    int l = strlen((char *)bufferReception);
-    for (int i = 0; i < l; i++)
-        bufferReception[i] = 0;
+    Trace(traceStats, time, {decoder, stats->Accepted, stats->Resync, stats->Recovered, stats->Retimed, stats->Corrected,
+                             stats->Refused, stats->Rejected[rejectLength], stats->Rejected[rejectChecksum], stats->Rejected[rejectId]});
 }
 
 void loopMH8A()
 {
-    long TimeFrame = micros();
-    static bool NoComm = false;
+    tDecoderEvent Event;
 
-    // No high value during long time -> end of frame
-    if ((TimeFrame - LastTime > TIME_END_FRAME) && (strlen((char *)bufferReception) > 0))
+    // Events sent by the decoding task
+    while (xQueueReceive(decodeQueue, &Event, 0) == pdTRUE)
     {
-        // Comm active as we received a frame
-        NoComm = false;
+        switch (Event.Type)
+        {
+        case eventFrame:
+            Decode(&Event.Frame, Event.Time);
+            break;
+
+        case eventReject:
+            Trace(traceReject, Event.Time, {(uint32_t)Event.Reason, (uint32_t)Event.Length});
+            break;
+
+        case eventError:
+            Trace(traceBadFrame, Event.Time, {Event.Frame.IdNumber, (uint32_t)Event.Frame.Pressure, (uint32_t)Event.Frame.Battery,
+                                              Event.Frame.ChecksumOk, Event.Frame.Corrected});
+            countTransmitterError(Event.Frame.IdNumber);
+            break;
+
+        case eventNoComm:
+            Trace(traceNoComm, Event.Time, {Event.Report.Overflow});
+            PrintStats(0, &Event.Report.Stream, Event.Time);
+            PrintStats(1, &Event.Report.Gap, Event.Time);
+            Trace(traceWindows, Event.Time, {Event.Report.Min0, Event.Report.Max0, Event.Report.Min1, Event.Report.Max1});
+
+            displayText(bottomLeftMid, 1, "No comm");
+            break;
+        }
+    }
 
-        // Decode the frame and display it on the console
-        frame = (char *)bufferReception;
-        Decode(frame, TimeFrame);
+    flushLog(false);
+}
 
-        // Init of variables
-        frame = "";
-        EmptyBuffer();
-    }
+bool receiverIdle()
+{
+    return (burstLength.load(std::memory_order_acquire) == 0) && (uxQueueMessagesWaiting(decodeQueue) == 0) &&
+           ((long)micros() - lastEdgeTime() > TIME_END_FRAME);
+}
 
-    // No high value during a longer time -> no more communication
-    if ((TimeFrame - LastTime > TIMEOUT) && (NoComm == false))
-    {
-        Serial.printf("No more communication\n");
+unsigned long rotateTanks()
+{
+    unsigned long Elapsed = millis() - tankMillis;
 
-        displayText(bottomLeftMid, 1, "No comm");
+    // A frame has displayed its tank in the meantime
+    if (Elapsed <= TANK_DISPLAY_TIME)
+        return TANK_DISPLAY_TIME - Elapsed + 1;
 
-        // Init of variables
-        frame = "";
-        EmptyBuffer();
+    evictStaleTransmitters(millis());
 
-        // No comm
-        NoComm = true;
-    }
+    int Slot = nextTank(tankId, &tankPinned);
+    if (Slot >= 0)
+        DisplayTank(transmitterAt(Slot));
+    else
+        tankMillis = millis();
+
+    return TANK_DISPLAY_TIME + 1;
 }
 
 void initMH8A()
 {
-    // Reading will be done trough interrupt thanks to AOP on the board
-    pinMode(INT_PIN_RECEIVER, INPUT);
-    attachInterrupt(digitalPinToInterrupt(INT_PIN_RECEIVER), ProcessIntPin, RISING);
-}
\ No newline at end of file
+    streamDecoder.Mode = DECODER_MODE;
+
+    loopTask = xTaskGetCurrentTaskHandle();
+    decodeQueue = xQueueCreate(DECODE_QUEUE_LENGTH, sizeof(tDecoderEvent));
+    xTaskCreatePinnedToCore(DecodeTask, "decode", DECODE_TASK_STACK, NULL, DECODE_TASK_PRIORITY, &decodeTask, DECODE_TASK_CORE);
+
+    traceRing.Verbosity = traceVerbosity;
+    xTaskCreatePinnedToCore(TraceTask, "trace", TRACE_TASK_STACK, NULL, TRACE_TASK_PRIORITY, &traceTask, DECODE_TASK_CORE);
+}
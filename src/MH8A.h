@@ -1,7 +1,42 @@
 #pragma once
 
-extern RTC_DATA_ATTR uint64_t timestamp;
+#include "flashlog.h"
+#include <initializer_list>
+#include "trace.h"
 
+// Pressure used for the time to reserve of the tanks - bar
+extern RTC_DATA_ATTR float reservePressure;
+
+// Events of the decoding task, loop() is notified of each one
 void loopMH8A();
 
+// No frame being received nor waiting for loop() : the receiver can sleep
+bool receiverIdle();
+
+// Several tanks in range : display them one after the other - returns the time before the next check (ms)
+unsigned long rotateTanks();
+
+// Keep the tank currently displayed on the screen, or release it
+void pinTank();
+
+// Start the capture and the decoding task, called from the task of loop()
 void initMH8A();
+
+// Messages of the decoding path and level of the ones sent to the USB (tTraceLevel)
+extern tTraceRing traceRing;
+extern RTC_DATA_ATTR int traceVerbosity;
+void Trace(tTraceType type, uint32_t time, std::initializer_list<uint32_t> args);
+
+// Called once the screen has been sent : latency of the last frame displayed
+void frameOnScreen();
+
+// Long-term history in the flash : mounted on the first use, readings are written by blocks
+// or all the ones waiting when force is set
+extern tLog flashLog;
+bool mountLog();
+void initLog(bool powerOn);
+void flushLog(bool force);
+
+// Free stack of the decoding task, longest time between 2 loops of the task since the last call
+// and # of events lost because loop() did not read them in time
+void decodeTaskStats(unsigned *stackFree, unsigned long *maxLoop, unsigned *queueFull);
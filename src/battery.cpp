@@ -0,0 +1,108 @@
+#include <math.h>
+#include "battery.h"
+
+// Discharge curve of a LiPo cell at a low current - V, charge
+static const float Curve[][2] = {
+    {3.30f, 0.00f}, {3.60f, 0.05f}, {3.69f, 0.10f}, {3.73f, 0.20f}, {3.77f, 0.30f}, {3.80f, 0.40f},
+    {3.84f, 0.50f}, {3.87f, 0.60f}, {3.95f, 0.70f}, {4.02f, 0.80f}, {4.11f, 0.90f}, {4.20f, 1.00f},
+};
+#define CURVE_POINTS (int)(sizeof(Curve) / sizeof(Curve[0]))
+
+void initBatteryMonitor(tBatteryMonitor *b, float gain, float offset)
+{
+    *b = tBatteryMonitor();
+    b->Gain = gain;
+    b->Offset = offset;
+    b->Shown = -1;
+}
+
+float batteryCharge(float volts)
+{
+    if (volts <= Curve[0][0])
+        return 0;
+
+    for (int i = 1; i < CURVE_POINTS; i++)
+        if (volts < Curve[i][0])
+            return Curve[i - 1][1] + (volts - Curve[i - 1][0]) * (Curve[i][1] - Curve[i - 1][1]) / (Curve[i][0] - Curve[i - 1][0]);
+
+    return 1;
+}
+
+// New value of the filter, from a complete block
+static void filterBlock(tBatteryMonitor *b, uint32_t now)
+{
+    float Raw = (float)b->Sum / BATTERY_DECIMATION;
+    float Volts = (Raw * b->Gain + b->Offset) * BATTERY_DIVIDER / 1000;
+
+    if (b->Blocks == 0)
+        b->Voltage = Volts;
+    else
+        b->Voltage += (Volts - b->Voltage) * BATTERY_WEIGHT;
+    b->Blocks++;
+    b->Charge = batteryCharge(b->Voltage);
+
+    if (b->Blocks == 1)
+    {
+        b->SlopeCharge = b->Charge;
+        b->SlopeTime = now;
+        return;
+    }
+
+    // Charge lost over the last BATTERY_SLOPE_TIME : the steps of the curve are too small to be seen more often
+    uint32_t Dt = now - b->SlopeTime;
+    if (Dt >= BATTERY_SLOPE_TIME)
+    {
+        float Rate = (b->SlopeCharge - b->Charge) / Dt;
+
+        if (Rate <= 0)
+            b->Rate = 0; // Charging, or not measurable
+        else if (b->Rate == 0)
+            b->Rate = Rate;
+        else
+            b->Rate += (Rate - b->Rate) * BATTERY_SLOPE_WEIGHT;
+
+        b->SlopeCharge = b->Charge;
+        b->SlopeTime = now;
+    }
+}
+
+int addBatterySamples(tBatteryMonitor *b, const uint16_t *raw, int nb, uint32_t now)
+{
+    int Values = 0;
+
+    for (int i = 0; i < nb; i++)
+    {
+        b->Sum += raw[i];
+        if (++b->Nb == BATTERY_DECIMATION)
+        {
+            filterBlock(b, now);
+            b->Sum = 0;
+            b->Nb = 0;
+            Values++;
+        }
+    }
+
+    return Values;
+}
+
+uint32_t batteryRuntime(const tBatteryMonitor *b)
+{
+    if (b->Rate <= 0)
+        return 0;
+
+    return (uint32_t)(b->Charge / b->Rate);
+}
+
+bool batteryDisplay(tBatteryMonitor *b, float *volts)
+{
+    if (b->Blocks == 0)
+        return false;
+
+    float Steps = b->Voltage / BATTERY_ROUND;
+    if ((b->Shown >= 0) && (fabsf(Steps - b->Shown) < BATTERY_HYSTERESIS))
+        return false;
+
+    b->Shown = (int)lroundf(Steps);
+    *volts = b->Shown * BATTERY_ROUND;
+    return true;
+}
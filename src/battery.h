@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stdint.h>
+
+// Battery of the receiver (1 LiPo cell, divided by 3 on the board) measured in the background by the ADC
+// The samples are averaged by blocks (oversampling : the noise of the 12 bit samples gives the steps in between),
+// each block is one value of an exponential filter. The state of charge is read on the discharge curve of the cell,
+// the runtime left is given by the charge lost over the last minutes
+#define BATTERY_DIVIDER 3          // Voltage divider of the board
+#define BATTERY_DECIMATION 256     // Samples averaged into one value
+#define BATTERY_WEIGHT 0.1f        // Weight of a new value in the filtered voltage
+#define BATTERY_ROUND 0.01f        // V - step of the voltage displayed
+#define BATTERY_HYSTERESIS 0.75f   // Steps - the voltage displayed changes when the filtered one is that far from it
+#define BATTERY_SLOPE_TIME 300     // s - charge lost measured over this time
+#define BATTERY_SLOPE_WEIGHT 0.3f  // Weight of a new measure in the rate of discharge
+
+typedef struct
+{
+    float Gain, Offset;     // mV at the pin = raw x Gain + Offset
+    uint32_t Sum;           // Samples of the current block
+    int Nb;
+    uint32_t Blocks;        // # of values filtered
+    float Voltage;          // V - filtered, at the battery
+    float Charge;           // 0..1
+    float Rate;             // Charge lost per second, 0 until known
+    float SlopeCharge;      // Charge at the start of the current measure of the slope
+    uint32_t SlopeTime;     // s
+    int Shown;              // Voltage displayed - steps of BATTERY_ROUND, -1 none
+} tBatteryMonitor;
+
+void initBatteryMonitor(tBatteryMonitor *b, float gain, float offset);
+
+// Samples of the ADC (raw, 12 bits), time in s - returns the # of values added to the filter
+int addBatterySamples(tBatteryMonitor *b, const uint16_t *raw, int nb, uint32_t now);
+
+// State of charge on the discharge curve of the cell, 0..1
+float batteryCharge(float volts);
+
+// s - runtime left at the current rate of discharge, 0 when not known
+uint32_t batteryRuntime(const tBatteryMonitor *b);
+
+// True when the voltage displayed must change, it is then given in V
+bool batteryDisplay(tBatteryMonitor *b, float *volts);
+
+// ADC of the board (battery_adc.cpp) : samples taken by the DMA, read by the job of loop()
+#define BATTERY_CHANNEL ADC1_CHANNEL_9 // GPIO10
+void initBatteryAdc(tBatteryMonitor *b);
+
+// Samples received since the last call added to the filter - returns the # of samples
+int readBatteryAdc(tBatteryMonitor *b, uint32_t now);
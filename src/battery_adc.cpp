@@ -0,0 +1,100 @@
+#include <Arduino.h>
+#include <driver/adc.h>
+#include <esp_adc_cal.h>
+#include "battery.h"
+#include "capture.h"
+
+#define BATTERY_VREF 1100              // mV - default reference, when the eFuse has none
+
+static void calibrate(tBatteryMonitor *b)
+{
+    esp_adc_cal_characteristics_t Chars;
+
+    // 11 dB : up to ~3.1 V at the pin
+    esp_adc_cal_characterize(ADC_UNIT_1, ADC_ATTEN_DB_11, ADC_WIDTH_BIT_12, BATTERY_VREF, &Chars);
+    initBatteryMonitor(b, Chars.coeff_a / 65536.0f, Chars.coeff_b);
+}
+
+#if CAPTURE_BACKEND == CAPTURE_ADC
+
+// The DMA of the ADC samples the receiver : the battery is one more entry of its pattern (capture_adc.cpp),
+// its samples are kept for this job by the decoding task
+#define BATTERY_FRAME 64 // Samples added at once
+
+void initBatteryAdc(tBatteryMonitor *b)
+{
+    calibrate(b);
+}
+
+int readBatteryAdc(tBatteryMonitor *b, uint32_t now)
+{
+    uint16_t Samples[BATTERY_FRAME];
+    int Total = 0;
+    int Nb;
+
+    while ((Nb = readCaptureBattery(Samples, BATTERY_FRAME)) > 0)
+    {
+        addBatterySamples(b, Samples, Nb, now);
+        Total += Nb;
+    }
+
+    return Total;
+}
+
+#else
+
+// Continuous conversions : the DMA fills the buffer of the driver in the background, no CPU until it is read
+// The DMA stops during a light sleep, the filter only gets fewer samples
+#define BATTERY_RATE 1000       // Hz - lowest rates of the ESP32-S3 are ~600 Hz
+#define BATTERY_FRAME 256       // Samples given by the DMA at once
+#define BATTERY_BUFFER 1024     // Samples kept by the driver - 1 s
+
+void initBatteryAdc(tBatteryMonitor *b)
+{
+    calibrate(b);
+
+    adc_digi_init_config_t Init = {};
+    Init.max_store_buf_size = BATTERY_BUFFER * sizeof(adc_digi_output_data_t);
+    Init.conv_num_each_intr = BATTERY_FRAME * sizeof(adc_digi_output_data_t);
+    Init.adc1_chan_mask = BIT(BATTERY_CHANNEL);
+    adc_digi_initialize(&Init);
+
+    adc_digi_pattern_config_t Pattern = {};
+    Pattern.atten = ADC_ATTEN_DB_11;
+    Pattern.channel = BATTERY_CHANNEL;
+    Pattern.unit = 0; // ADC1
+    Pattern.bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+
+    adc_digi_configuration_t Config = {};
+    Config.pattern_num = 1;
+    Config.adc_pattern = &Pattern;
+    Config.sample_freq_hz = BATTERY_RATE;
+    Config.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+    Config.format = ADC_DIGI_OUTPUT_FORMAT_TYPE2;
+    adc_digi_controller_configure(&Config);
+
+    adc_digi_start();
+}
+
+int readBatteryAdc(tBatteryMonitor *b, uint32_t now)
+{
+    adc_digi_output_data_t Data[BATTERY_FRAME];
+    uint16_t Samples[BATTERY_FRAME];
+    uint32_t Size = 0;
+    int Total = 0;
+
+    while (adc_digi_read_bytes((uint8_t *)Data, sizeof(Data), &Size, 0) == ESP_OK)
+    {
+        int Nb = 0;
+        for (int i = 0; i < (int)(Size / sizeof(adc_digi_output_data_t)); i++)
+            if (Data[i].type2.channel == BATTERY_CHANNEL)
+                Samples[Nb++] = Data[i].type2.data;
+
+        addBatterySamples(b, Samples, Nb, now);
+        Total += Nb;
+    }
+
+    return Total;
+}
+
+#endif
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "rawcapture.h"
+
+// Backends giving the duration of the pauses between 2 bursts of carrier
+// Selected at build time, for instance with -D CAPTURE_BACKEND=CAPTURE_RMT
+#define CAPTURE_GPIO 0 // Interrupt on each rising edge of the carrier
+#define CAPTURE_RMT 1  // RMT receiver demodulating the carrier, one batch of durations per frame
+#define CAPTURE_ADC 2  // ADC sampled by DMA, carrier found by Goertzel (boards without the op-amp)
+
+#ifndef CAPTURE_BACKEND
+#define CAPTURE_BACKEND CAPTURE_GPIO
+#endif
+
+#define INT_PIN_RECEIVER 4 // GPIO4
+
+// CAPTURE_ADC : the battery takes 1 conversion out of ADC_PATTERN of the DMA, the carrier takes the others
+#define ADC_PATTERN 16
+
+void initCapture();
+
+// Give the next pause received - return false if there is nothing new
+bool readPulse(uint16_t *delta);
+
+// Time of the last burst of carrier received - us
+long lastEdgeTime();
+
+// # of pauses lost because the decoder did not read them in time (RMT : not known, always 0)
+uint32_t captureOverflow();
+
+// Drop everything received and not read yet
+void flushCapture();
+
+// Before a light sleep : the carrier wakes the chip up - returns false if the backend cannot sleep
+bool captureSleep();
+
+// After the light sleep
+void captureWake();
+
+// Raw edges kept for a replay on the host, nullptr if the backend or the board cannot keep them
+tRawCapture *getRawCapture();
+
+#if CAPTURE_BACKEND == CAPTURE_RMT
+// # of batches read while the ring of the driver had no room left for one more : batches may have been dropped
+uint32_t captureRingFull();
+#endif
+
+#if CAPTURE_BACKEND == CAPTURE_ADC
+// Samples of the battery taken by the DMA of the capture (raw, 12 bits) - returns the # given
+int readCaptureBattery(uint16_t *raw, int max);
+#endif
+
+#ifndef ARDUINO
+// Host build : the pauses are replayed from an array
+void replayCapture(const uint16_t *durations, size_t nb);
+#endif
@@ -0,0 +1,158 @@
+#include "capture.h"
+
+#if CAPTURE_BACKEND == CAPTURE_ADC
+
+#include <Arduino.h>
+#include <driver/adc.h>
+#include "decoder.h"
+#include "goertzel.h"
+#include "ringbuffer.h"
+#include "metrics.h"
+#include "battery.h"
+
+// The signal of the receiver is sampled as it is by the ADC, without the op-amp and its comparator
+// The DMA fills a buffer in the background, the carrier is found in the samples by readPulse
+#define ADC_CHANNEL ADC1_CHANNEL_3 // GPIO4
+#define ADC_FRAME_SAMPLES 256      // Samples given by the DMA at once - 3 ms
+#define ADC_BUFFER_SAMPLES 2048    // Samples kept by the driver - 25 ms
+#define ADC_BATTERY_KEEP 16        // 1 sample of the battery kept out of 16 - ~330 Hz, read every 500 ms by loop()
+
+static tCarrierDetector Detector;
+static tPulseBuffer pulseBuffer;
+static long LastTime = 0;
+
+// Samples of the battery, from the decoding task to loop()
+static tPulseBuffer batteryBuffer;
+static int BatterySkip = 0;
+static int32_t Sum = 0; // Samples of the carrier since the last slot of the battery
+
+void initCapture()
+{
+    initCarrierDetector(&Detector);
+
+    adc_digi_init_config_t Init = {};
+    Init.max_store_buf_size = ADC_BUFFER_SAMPLES * sizeof(adc_digi_output_data_t);
+    Init.conv_num_each_intr = ADC_FRAME_SAMPLES * sizeof(adc_digi_output_data_t);
+    Init.adc1_chan_mask = BIT(ADC_CHANNEL) | BIT(BATTERY_CHANNEL);
+    adc_digi_initialize(&Init);
+
+    // Small signal from the receiver : no attenuation. The battery is the last entry : up to ~3.1 V at the pin
+    adc_digi_pattern_config_t Pattern[ADC_PATTERN] = {};
+    for (int i = 0; i < ADC_PATTERN; i++)
+    {
+        bool Battery = (i == ADC_PATTERN - 1);
+
+        Pattern[i].atten = Battery ? ADC_ATTEN_DB_11 : ADC_ATTEN_DB_0;
+        Pattern[i].channel = Battery ? BATTERY_CHANNEL : ADC_CHANNEL;
+        Pattern[i].unit = 0; // ADC1
+        Pattern[i].bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+    }
+
+    adc_digi_configuration_t Config = {};
+    Config.pattern_num = ADC_PATTERN;
+    Config.adc_pattern = Pattern;
+    Config.sample_freq_hz = CARRIER_RATE;
+    Config.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+    Config.format = ADC_DIGI_OUTPUT_FORMAT_TYPE2;
+    adc_digi_controller_configure(&Config);
+
+    adc_digi_start();
+}
+
+// Samples received by the DMA since the last call, the pauses found are pushed to the buffer
+static void readSamples()
+{
+    adc_digi_output_data_t Data[ADC_FRAME_SAMPLES];
+    int16_t Samples[ADC_FRAME_SAMPLES];
+    uint16_t Pauses[ADC_FRAME_SAMPLES / CARRIER_BLOCK];
+    uint32_t Size = 0;
+
+    while (adc_digi_read_bytes((uint8_t *)Data, sizeof(Data), &Size, 0) == ESP_OK)
+    {
+        int Nb = 0;
+        for (int i = 0; i < (int)(Size / sizeof(adc_digi_output_data_t)); i++)
+        {
+            if (Data[i].type2.channel == ADC_CHANNEL)
+            {
+                Samples[Nb++] = Data[i].type2.data;
+                Sum += Data[i].type2.data;
+            }
+            else if (Data[i].type2.channel == BATTERY_CHANNEL)
+            {
+                // The slot of the battery is filled with the offset of the signal, without carrier : the blocks
+                // stay on the clock of the DMA (the previous sample would add a wrong phase of the carrier)
+                Samples[Nb++] = (int16_t)(Sum / (ADC_PATTERN - 1));
+                Sum = 0;
+
+                // Dropped when loop() is late : the filter of the battery only gets fewer samples
+                if (++BatterySkip == ADC_BATTERY_KEEP)
+                {
+                    BatterySkip = 0;
+                    pushPulse(&batteryBuffer, Data[i].type2.data);
+                }
+            }
+        }
+
+        int NbPauses = detectCarrier(&Detector, Samples, Nb, Pauses, ADC_FRAME_SAMPLES / CARRIER_BLOCK);
+
+        // One burst found, counted as one edge like the RMT does
+        countMetric(metricEdges, NbPauses);
+        for (int i = 0; i < NbPauses; i++)
+            pushPulse(&pulseBuffer, Pauses[i]);
+
+        // The last sample has just been taken
+        LastTime = micros() - carrierSilence(&Detector);
+    }
+}
+
+bool readPulse(uint16_t *delta)
+{
+    if (popPulse(&pulseBuffer, delta))
+        return true;
+
+    readSamples();
+    return popPulse(&pulseBuffer, delta);
+}
+
+long lastEdgeTime()
+{
+    return LastTime;
+}
+
+uint32_t captureOverflow()
+{
+    return pulseBuffer.Overflow.load(std::memory_order_relaxed);
+}
+
+bool captureSleep()
+{
+    // The DMA of the ADC stops during a light sleep, and an analog level cannot wake the chip up
+    return false;
+}
+
+void captureWake()
+{
+}
+
+void flushCapture()
+{
+    readSamples();
+    flushPulses(&pulseBuffer);
+}
+
+tRawCapture *getRawCapture()
+{
+    // No edges, only samples
+    return nullptr;
+}
+
+int readCaptureBattery(uint16_t *raw, int max)
+{
+    int Nb = 0;
+
+    while ((Nb < max) && popPulse(&batteryBuffer, &raw[Nb]))
+        Nb++;
+    return Nb;
+}
+
+#endif
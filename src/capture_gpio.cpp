@@ -0,0 +1,104 @@
+#include "capture.h"
+
+#if CAPTURE_BACKEND == CAPTURE_GPIO
+
+#include <Arduino.h>
+#include <esp_ipc.h>
+#include "decoder.h"
+#include "ringbuffer.h"
+#include "metrics.h"
+#include "rawcapture.h"
+
+// Shared variable between interrupt and main code
+volatile long LastTime = 0;
+tPulseBuffer pulseBuffer;
+tRawCapture rawCapture;
+
+// Core of the interrupt : its enable bit is per core
+static int IsrCore = 0;
+
+// Purpose is to measure the time between the last high level and then to wait the pause to get the next high level
+// 0 is then 1ms sinusoid + 1 ms pause
+// and 1 is 1ms sinusoid + 2ms pause
+// Edges of the carrier inside a burst are ignored, only the pauses are pushed to the main loop
+void IRAM_ATTR ProcessIntPin()
+{
+    long Time = micros();
+    long Delta = Time - LastTime;
+
+    LastTime = Time;
+    countMetric(metricEdges);
+    if (rawCapture.Enabled.load(std::memory_order_relaxed))
+        recordEdge(&rawCapture, Time);
+
+    uint16_t Pulse = edgeToPulse(Delta);
+    if (Pulse)
+        pushPulse(&pulseBuffer, Pulse);
+}
+
+void initCapture()
+{
+    // Raw capture only when there is some PSRAM
+    rawCapture.Edges = (uint32_t *)ps_malloc(RAW_CAPTURE_EDGES * sizeof(uint32_t));
+    rawCapture.Enabled.store(RAW_CAPTURE_ON && rawCapture.Edges);
+
+    // Reading will be done trough interrupt thanks to AOP on the board
+    pinMode(INT_PIN_RECEIVER, INPUT);
+    IsrCore = xPortGetCoreID();
+    attachInterrupt(digitalPinToInterrupt(INT_PIN_RECEIVER), ProcessIntPin, RISING);
+}
+
+bool readPulse(uint16_t *delta)
+{
+    if (popPulse(&pulseBuffer, delta))
+        return true;
+
+    // Nothing more to decode : edges recorded by the interrupt moved to PSRAM
+    // Also when the capture is off, so that a pause of the download is acknowledged
+    moveRawEdges(&rawCapture);
+    return false;
+}
+
+tRawCapture *getRawCapture()
+{
+    return rawCapture.Edges ? &rawCapture : nullptr;
+}
+
+long lastEdgeTime()
+{
+    return LastTime;
+}
+
+uint32_t captureOverflow()
+{
+    return pulseBuffer.Overflow.load(std::memory_order_relaxed);
+}
+
+// Edge interrupt armed again, on the core it has been attached on
+static void armEdge(void *)
+{
+    gpio_set_intr_type((gpio_num_t)INT_PIN_RECEIVER, GPIO_INTR_POSEDGE);
+    gpio_intr_enable((gpio_num_t)INT_PIN_RECEIVER);
+}
+
+bool captureSleep()
+{
+    // Level of the pin : the edge interrupt does not wake the chip from light sleep. It is disabled first, or the
+    // level would call it again and again as long as the carrier is there
+    gpio_intr_disable((gpio_num_t)INT_PIN_RECEIVER);
+    gpio_wakeup_enable((gpio_num_t)INT_PIN_RECEIVER, GPIO_INTR_HIGH_LEVEL);
+    return true;
+}
+
+void captureWake()
+{
+    gpio_wakeup_disable((gpio_num_t)INT_PIN_RECEIVER);
+    esp_ipc_call_blocking(IsrCore, armEdge, NULL);
+}
+
+void flushCapture()
+{
+    flushPulses(&pulseBuffer);
+}
+
+#endif
@@ -0,0 +1,147 @@
+#include "capture.h"
+
+#if CAPTURE_BACKEND == CAPTURE_RMT
+
+#include <Arduino.h>
+#include <driver/rmt.h>
+#include "decoder.h"
+#include "metrics.h"
+
+#define RMT_RX_CHANNEL RMT_CHANNEL_4 // First channel able to receive on ESP32-S3
+#define RMT_CLK_DIV 80               // 1 tick = 1us with the 80MHz APB clock
+#define RMT_IDLE_THRESHOLD 5000      // us - longer than a 1, so that a whole frame is one batch
+#define RMT_FILTER_TICKS 200         // APB ticks - glitches shorter than 2.5us are ignored
+#define RMT_BUFFER_SIZE 2048         // bytes - ~8 frames of durations
+#define RMT_BATCH_SIZE (64 * sizeof(rmt_item32_t) + 8) // bytes - longest batch in the ring : a frame, a few spurious bursts
+
+static RingbufHandle_t RingBuffer = NULL;
+
+// Batch being read
+static rmt_item32_t *Items = NULL;
+static size_t NbItems = 0;
+static size_t Pos = 0;
+
+static long LastTime = 0;
+
+// Times the ring of the driver has been found without room for one more batch : a batch may have been dropped
+static uint32_t RingFull = 0;
+
+void initCapture()
+{
+    rmt_config_t Config = RMT_DEFAULT_CONFIG_RX((gpio_num_t)INT_PIN_RECEIVER, RMT_RX_CHANNEL);
+
+    Config.clk_div = RMT_CLK_DIV;
+    Config.rx_config.idle_threshold = RMT_IDLE_THRESHOLD;
+    Config.rx_config.filter_en = true;
+    Config.rx_config.filter_ticks_thresh = RMT_FILTER_TICKS;
+
+    // The carrier is removed by the RMT : level 1 during a burst, level 0 during a pause
+    Config.rx_config.rm_carrier = true;
+    Config.rx_config.carrier_freq_hz = 38000;
+    Config.rx_config.carrier_duty_percent = 50;
+    Config.rx_config.carrier_level = RMT_CARRIER_LEVEL_HIGH;
+
+    rmt_config(&Config);
+    rmt_driver_install(RMT_RX_CHANNEL, RMT_BUFFER_SIZE, 0);
+    rmt_get_ringbuf_handle(RMT_RX_CHANNEL, &RingBuffer);
+    rmt_rx_start(RMT_RX_CHANNEL, true);
+}
+
+bool readPulse(uint16_t *delta)
+{
+    while (true)
+    {
+        // Get the next batch of durations
+        if (Items == NULL)
+        {
+            size_t Size = 0;
+
+            // The driver drops a batch that does not fit in its ring without reporting it : the ring is checked
+            // before each batch is taken out, while it is as full as it has been. Not a count of the batches lost
+            if (xRingbufferGetCurFreeSize(RingBuffer) < RMT_BATCH_SIZE)
+                RingFull++;
+
+            Items = (rmt_item32_t *)xRingbufferReceive(RingBuffer, &Size, 0);
+            if (Items == NULL)
+                return false;
+
+            NbItems = Size / sizeof(rmt_item32_t);
+            Pos = 0;
+
+            // Carrier demodulated by the RMT : one item per burst, counted as one edge
+            countMetric(metricEdges, NbItems);
+
+            // The batch is received after the idle threshold following the last burst
+            LastTime = micros() - RMT_IDLE_THRESHOLD;
+        }
+
+        // Each item is made of 2 levels with their durations, only the pauses are used
+        while (Pos < NbItems * 2)
+        {
+            rmt_item32_t *Item = &Items[Pos / 2];
+            uint32_t Level = (Pos & 1) ? Item->level1 : Item->level0;
+            uint32_t Duration = (Pos & 1) ? Item->duration1 : Item->duration0;
+
+            Pos++;
+
+            uint16_t Pulse = edgeToPulse(Duration);
+            if ((Level == 0) && Pulse)
+            {
+                *delta = Pulse;
+                return true;
+            }
+        }
+
+        vRingbufferReturnItem(RingBuffer, Items);
+        Items = NULL;
+    }
+}
+
+long lastEdgeTime()
+{
+    return LastTime;
+}
+
+uint32_t captureOverflow()
+{
+    // The driver does not report the batches it drops, see captureRingFull()
+    return 0;
+}
+
+uint32_t captureRingFull()
+{
+    return RingFull;
+}
+
+bool captureSleep()
+{
+    // The pad is still read by the GPIO during the light sleep, the RMT is stopped. The level is only a wake-up
+    // source : no interrupt of the GPIO is enabled on it
+    rmt_rx_stop(RMT_RX_CHANNEL);
+    gpio_intr_disable((gpio_num_t)INT_PIN_RECEIVER);
+    gpio_wakeup_enable((gpio_num_t)INT_PIN_RECEIVER, GPIO_INTR_HIGH_LEVEL);
+    return true;
+}
+
+void captureWake()
+{
+    gpio_wakeup_disable((gpio_num_t)INT_PIN_RECEIVER);
+    gpio_set_intr_type((gpio_num_t)INT_PIN_RECEIVER, GPIO_INTR_DISABLE);
+    rmt_rx_start(RMT_RX_CHANNEL, true);
+}
+
+void flushCapture()
+{
+    uint16_t Delta;
+
+    while (readPulse(&Delta))
+        ;
+}
+
+tRawCapture *getRawCapture()
+{
+    // Only the durations are known, not the edges
+    return nullptr;
+}
+
+#endif
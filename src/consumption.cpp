@@ -0,0 +1,83 @@
+#include <math.h>
+#include "consumption.h"
+
+static void restart(tConsumption *c, float bar, uint32_t now)
+{
+    uint32_t Outliers = c->Outliers;
+
+    *c = tConsumption();
+    c->Outliers = Outliers;
+    c->Started = true;
+    c->LastTime = now;
+    c->S0 = 1;
+    c->Sp = bar;
+}
+
+bool updateConsumption(tConsumption *c, float bar, uint32_t now)
+{
+    if (!c->Started)
+    {
+        restart(c, bar, now);
+        return true;
+    }
+
+    float Dt = (now - c->LastTime) / 60000.0f;
+
+    // Fit moved to the time of the new reading : t becomes t - Dt
+    float St = c->St - Dt * c->S0;
+    float Sp = c->Sp;
+    float Stt = c->Stt - 2 * Dt * c->St + Dt * Dt * c->S0;
+    float Stp = c->Stp - Dt * c->Sp;
+
+    float Det = c->S0 * Stt - St * St;
+    bool Fitted = (c->Span >= CONSUMPTION_MIN_SPAN) && (Det > 1e-6f);
+
+    // Reading too far from the pressure expected now
+    if (Fitted)
+    {
+        float Slope = (c->S0 * Stp - St * Sp) / Det;
+        float Expected = (Sp - Slope * St) / c->S0;
+        float Residual = bar - Expected;
+        float Limit = fmaxf(CONSUMPTION_OUTLIER * sqrtf(c->Variance), CONSUMPTION_OUTLIER_MIN);
+
+        if (fabsf(Residual) > Limit)
+        {
+            c->Outliers++;
+            if (++c->InRow >= CONSUMPTION_RESET)
+                restart(c, bar, now);
+            return false;
+        }
+
+        c->Variance += CONSUMPTION_TREND * (Residual * Residual - c->Variance);
+    }
+
+    c->InRow = 0;
+
+    // Old readings forgotten a bit more, then the new one is added at t = 0
+    float Forget = expf(-Dt / CONSUMPTION_WINDOW);
+
+    c->S0 = c->S0 * Forget + 1;
+    c->St = St * Forget;
+    c->Sp = Sp * Forget + bar;
+    c->Stt = Stt * Forget;
+    c->Stp = Stp * Forget;
+    c->Span = c->Span * Forget + Dt;
+    c->LastTime = now;
+
+    Det = c->S0 * c->Stt - c->St * c->St;
+    if ((c->Span >= CONSUMPTION_MIN_SPAN) && (Det > 1e-6f))
+    {
+        c->Rate = -(c->S0 * c->Stp - c->St * c->Sp) / Det;
+        c->Trend = (c->Trend == 0) ? c->Rate : c->Trend + CONSUMPTION_TREND * (c->Rate - c->Trend);
+    }
+
+    return true;
+}
+
+float timeToReserve(const tConsumption *c, float bar, float reserve)
+{
+    if (c->Trend < CONSUMPTION_MIN_RATE)
+        return -1;
+
+    return (bar > reserve) ? (bar - reserve) / c->Trend : 0;
+}
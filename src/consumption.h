@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdint.h>
+
+// Gas consumption of a tank from its successive pressures
+// Linear regression of the pressure over time with an exponential forgetting : the readings older than
+// CONSUMPTION_WINDOW count less and less, the memory and the cost of an update are constant
+#define CONSUMPTION_WINDOW 3.0f       // min - time constant of the forgetting
+#define CONSUMPTION_MIN_SPAN 1.0f     // min - no rate before this time of readings
+#define CONSUMPTION_TREND 0.2f        // Weight of a new rate in the smoothed trend
+#define CONSUMPTION_OUTLIER 4.0f      // Reading rejected if further than this # of standard deviations...
+#define CONSUMPTION_OUTLIER_MIN 3.0f  // bar - ...and than this
+#define CONSUMPTION_RESET 3           // # of outliers in a row : tank changed or filled, regression restarted
+#define CONSUMPTION_MIN_RATE 0.05f    // bar/min - below, the tank is not used : no time to reserve
+#define RESERVE_PRESSURE 50.0f        // bar - default
+
+typedef struct
+{
+    // Weighted sums of the regression, time origin on the last reading accepted - min, bar
+    float S0, St, Sp, Stt, Stp;
+    float Span;        // min - weighted time covered by the readings
+    float Variance;    // bar² - of the residuals
+    uint32_t LastTime; // ms
+    bool Started;
+    uint8_t InRow;     // Outliers in a row
+    uint32_t Outliers; // # of readings rejected
+    float Rate;        // bar/min, 0 until known
+    float Trend;       // bar/min - rate smoothed
+} tConsumption;
+
+// New pressure of the tank - bar, time in ms
+// Returns false when the reading is rejected as an outlier
+bool updateConsumption(tConsumption *c, float bar, uint32_t now);
+
+// min - time until the reserve pressure at the current trend, -1 when not known
+float timeToReserve(const tConsumption *c, float bar, float reserve);
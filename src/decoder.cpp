@@ -0,0 +1,497 @@
+#include <stdlib.h>
+#include "decoder.h"
+
+// For tank ID, the protocol is using a dedicated coding for each number
+// This table gives the digit for each possible value of the 4 bits
+static constexpr char NibbleToDigit[16] = {
+    '!', '!', '!', '3', '!', '5', '6', '7',
+    '!', '9', '0', '1', '2', '4', '8', '!'};
+
+// Extract "length" bits starting at bit "start" of the frame (bit 0 is the first received)
+static inline uint32_t field(uint64_t bits, int start, int length)
+{
+    return (bits >> (FRAME_LENGTH - start - length)) & ((1u << length) - 1);
+}
+
+int classifyPulse(uint16_t delta)
+{
+    if ((delta > TIME_MIN_0) && (delta < TIME_MAX_0))
+        return 0;
+    if ((delta > TIME_MIN_1) && (delta < TIME_MAX_1))
+        return 1;
+
+    return BIT_NONE;
+}
+
+static inline void addBit(tFrameBits *frame, int bit)
+{
+    frame->Bits = (frame->Bits << 1) | bit;
+    frame->Length++;
+}
+
+void addPulse(tFrameBits *frame, uint16_t delta)
+{
+    int Bit = classifyPulse(delta);
+
+    if (Bit != BIT_NONE)
+        addBit(frame, Bit);
+}
+
+// Center of the cluster around the highest bin in [first, last[ - 0 if not enough pauses
+static uint16_t clusterCenter(const tTiming *timing, int first, int last)
+{
+    int Peak = first;
+
+    for (int i = first; i < last; i++)
+        if (timing->Count[i] > timing->Count[Peak])
+            Peak = i;
+
+    // Weighted mean on the peak and its 2 neighbours
+    uint32_t Sum = 0, Nb = 0;
+    for (int i = Peak - 1; i <= Peak + 1; i++)
+    {
+        if ((i < first) || (i >= last))
+            continue;
+
+        Sum += timing->Count[i] * (i * HISTOGRAM_BIN + HISTOGRAM_BIN / 2);
+        Nb += timing->Count[i];
+    }
+
+    return (Nb < HISTOGRAM_MIN_COUNT) ? 0 : Sum / Nb;
+}
+
+void updateTiming(tTiming *timing, uint16_t delta)
+{
+    // Silence between 2 frames or noise
+    if (delta >= HISTOGRAM_BINS * HISTOGRAM_BIN)
+        return;
+
+    timing->Count[delta / HISTOGRAM_BIN]++;
+
+    if (++timing->NbPulses < HISTOGRAM_UPDATE)
+        return;
+
+    timing->NbPulses = 0;
+
+    uint16_t Center0 = clusterCenter(timing, TIME_MIN_PULSE / HISTOGRAM_BIN, TIME_MIDDLE_01 / HISTOGRAM_BIN);
+    uint16_t Center1 = clusterCenter(timing, TIME_MIDDLE_01 / HISTOGRAM_BIN, HISTOGRAM_BINS);
+
+    // Same width as the fixed windows, without overlap between 0 and 1
+    if (Center0 && Center1)
+    {
+        uint16_t Middle = (Center0 + Center1) / 2;
+        uint16_t Half = (TIME_MAX_0 - TIME_MIN_0) / 2;
+
+        timing->Center0 = Center0;
+        timing->Center1 = Center1;
+        timing->Min0 = Center0 - Half;
+        timing->Max0 = (Center0 + Half < Middle) ? Center0 + Half : Middle;
+        timing->Min1 = (Center1 - Half > Middle) ? Center1 - Half : Middle;
+        timing->Max1 = Center1 + Half;
+    }
+
+    // Forget the old pauses
+    for (int i = 0; i < HISTOGRAM_BINS; i++)
+        timing->Count[i] /= 2;
+}
+
+int classifyPulse(const tTiming *timing, uint16_t delta)
+{
+    if (timing->Center0 == 0)
+        return classifyPulse(delta);
+
+    if ((delta > timing->Min0) && (delta < timing->Max0))
+        return 0;
+    if ((delta > timing->Min1) && (delta < timing->Max1))
+        return 1;
+
+    return BIT_NONE;
+}
+
+bool decodeFrame(uint64_t bits, int length, tFrame *frame)
+{
+    // If length is not the good one, exit
+    if (length != FRAME_LENGTH)
+        return false;
+
+    // Get the different parts of the frame
+    frame->Preamble = field(bits, 0, 2);
+    frame->Sync1 = field(bits, 2, 4);
+    frame->Sync2 = field(bits, 6, 4);
+
+    // For ID, 6 digits to be replaced with the lookup table
+    frame->IdValid = true;
+    frame->IdNumber = 0;
+    for (int i = 0; i < 6; i++)
+    {
+        frame->ID[i] = NibbleToDigit[field(bits, 10 + i * 4, 4)];
+        if (frame->ID[i] == '!')
+            frame->IdValid = false;
+        else
+            frame->IdNumber = frame->IdNumber * 10 + frame->ID[i] - '0';
+    }
+    frame->ID[6] = 0;
+
+    // Pressure is encoded in PSI - 12bits
+    // The value in the frame is half of the real value
+    frame->Pressure = field(bits, 34, 12);
+
+    // Battery status can be Good, Low, Critical with a specific coding
+    uint32_t Batt = field(bits, 46, 4);
+    frame->Battery = (Batt == 0x0) ? batteryGood : (Batt == 0x2) ? batteryLow
+                                               : (Batt == 0x1)   ? batteryCritical
+                                                                 : batteryUnknown;
+
+    // Checksum is calculated as following :
+    // Remove the 2 first bits (Preamble)
+    // Add the integer value of each 4 bits (12 nibbles)
+    frame->ChecksumCalc = 0;
+    for (int i = 0; i < 12; i++)
+        frame->ChecksumCalc += field(bits, 2 + i * 4, 4);
+
+    // Checksum is located in the 8 last bits of the frame
+    frame->ChecksumMsg = field(bits, 50, 8);
+
+    frame->ChecksumOk = (frame->ChecksumCalc == frame->ChecksumMsg);
+    frame->Corrected = false;
+
+    return true;
+}
+
+bool frameValid(const tFrame *frame, tReject *reason)
+{
+    if (!frame->ChecksumOk)
+        *reason = rejectChecksum;
+    else if (!frame->IdValid)
+        *reason = rejectId;
+    else
+        return true;
+
+    return false;
+}
+
+// Distance between the pause and the nearest limit of the window which gave its bit
+static uint8_t pulseConfidence(const tStreamDecoder *decoder, uint16_t delta, int bit)
+{
+    const tTiming *Timing = &decoder->Timing;
+    bool Learned = (decoder->Mode == decoderAdaptive) && (Timing->Center0 != 0);
+    int Min, Max;
+
+    if (bit == 0)
+    {
+        Min = Learned ? Timing->Min0 : TIME_MIN_0;
+        Max = Learned ? Timing->Max0 : TIME_MAX_0;
+    }
+    else
+    {
+        Min = Learned ? Timing->Min1 : TIME_MIN_1;
+        Max = Learned ? Timing->Max1 : TIME_MAX_1;
+    }
+
+    int Distance = (delta - Min < Max - delta) ? delta - Min : Max - delta;
+
+    return (Distance > 255) ? 255 : Distance;
+}
+
+bool streamPulse(tStreamDecoder *decoder, uint16_t delta, tFrame *frame)
+{
+    tReject Reason;
+    int Fixed = classifyPulse(delta);
+    int Bit = Fixed;
+
+    if (decoder->Mode == decoderAdaptive)
+    {
+        updateTiming(&decoder->Timing, delta);
+        Bit = classifyPulse(&decoder->Timing, delta);
+
+        if (decoder->NbPauses < BURST_PAUSES)
+            decoder->Pauses[decoder->NbPauses++] = delta;
+    }
+
+    if (Fixed != BIT_NONE)
+        addBit(&decoder->Burst, Fixed);
+
+    // Pause out of the windows
+    if (Bit == BIT_NONE)
+    {
+        decoder->OutOfWindow++;
+        return false;
+    }
+
+    decoder->Symbols[Bit]++;
+
+    decoder->Confidence[decoder->Window.Length & 63] = pulseConfidence(decoder, delta, Bit);
+    addBit(&decoder->Window, Bit);
+    decoder->FixedMiss = (decoder->FixedMiss << 1) | (Fixed != Bit);
+
+    // Not enough bits yet
+    if (decoder->Window.Length < FRAME_LENGTH)
+        return false;
+
+    // Slide on the last 58 bits, spurious leading bits are dropped
+    uint64_t Bits = decoder->Window.Bits & ((1ULL << FRAME_LENGTH) - 1);
+
+    decodeFrame(Bits, FRAME_LENGTH, frame);
+    if (!frameValid(frame, &Reason))
+    {
+        // A valid checksum with an unknown digit is kept as the reason of the burst, the next windows
+        // sliding on spurious bits would only give a wrong checksum
+        if ((Reason == rejectId) || (decoder->LastReject != rejectId))
+            decoder->LastReject = Reason;
+        return false;
+    }
+
+    decoder->Stream.Accepted++;
+    if (decoder->Window.Length > FRAME_LENGTH)
+        decoder->Stream.Resync++;
+    if (decoder->FixedMiss & ((1ULL << FRAME_LENGTH) - 1))
+        decoder->Stream.Recovered++;
+
+    // Start again from an empty window : a frame is never emitted twice
+    decoder->Window.Bits = 0;
+    decoder->Window.Length = 0;
+    decoder->FixedMiss = 0;
+    decoder->Emitted = true;
+    decoder->FrameId = frame->IdNumber;
+    decoder->FramePressure = frame->Pressure;
+    decoder->FrameBattery = frame->Battery;
+
+    return true;
+}
+
+bool streamRetime(tStreamDecoder *decoder, tFrame *frame)
+{
+    tReject Reason;
+
+    if (decoder->Emitted || (decoder->Mode != decoderAdaptive))
+        return false;
+
+    for (int k = 0; k < DECODER_IDS; k++)
+    {
+        const tKnownId *Known = &decoder->Known[k];
+        tFrameBits Window = {0, 0};
+
+        if (!Known->Used || (Known->Timing.Center0 == 0))
+            continue;
+
+        // Same sliding window as streamPulse(), only the ID of this transmitter is accepted
+        for (int i = 0; i < decoder->NbPauses; i++)
+        {
+            int Bit = classifyPulse(&Known->Timing, decoder->Pauses[i]);
+
+            if (Bit == BIT_NONE)
+                continue;
+            addBit(&Window, Bit);
+            if (Window.Length < FRAME_LENGTH)
+                continue;
+
+            decodeFrame(Window.Bits & ((1ULL << FRAME_LENGTH) - 1), FRAME_LENGTH, frame);
+            if (frameValid(frame, &Reason) && (frame->IdNumber == Known->Id))
+            {
+                decoder->Stream.Accepted++;
+                decoder->Stream.Retimed++;
+                decoder->Emitted = true;
+                decoder->FrameId = frame->IdNumber;
+                decoder->FramePressure = frame->Pressure;
+                decoder->FrameBattery = frame->Battery;
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+// Entry of a transmitter already heard, NULL if none
+static const tKnownId *findKnownId(const tStreamDecoder *decoder, uint32_t id)
+{
+    for (int k = 0; k < DECODER_IDS; k++)
+        if (decoder->Known[k].Used && (decoder->Known[k].Id == id))
+            return &decoder->Known[k];
+
+    return NULL;
+}
+
+// Entry of the transmitter, the one heard the longest ago is replaced when it is not known
+static tKnownId *knownId(tStreamDecoder *decoder, uint32_t id)
+{
+    tKnownId *Oldest = &decoder->Known[0];
+
+    for (int k = 0; k < DECODER_IDS; k++)
+    {
+        tKnownId *Known = &decoder->Known[k];
+
+        if (Known->Used && (Known->Id == id))
+            return Known;
+        if (!Known->Used || (Oldest->Used && (decoder->Bursts - Known->LastBurst > decoder->Bursts - Oldest->LastBurst)))
+            Oldest = Known;
+    }
+
+    *Oldest = tKnownId();
+    Oldest->Used = true;
+    Oldest->Id = id;
+
+    return Oldest;
+}
+
+// Valid and plausible frame once the bits of the mask are flipped
+static bool tryCorrection(uint64_t bits, uint64_t mask, tFrame *frame)
+{
+    tReject Reason;
+
+    decodeFrame(bits ^ mask, FRAME_LENGTH, frame);
+
+    return frameValid(frame, &Reason) && (frame->Pressure <= MAX_PRESSURE);
+}
+
+bool streamCorrect(tStreamDecoder *decoder, tFrame *frame)
+{
+    int Weakest[CORRECTION_BITS]; // Position in the window, the least reliable first
+    int Nb = 0;
+    int Found = 0;
+    uint64_t Bits = decoder->Window.Bits;
+    tFrame Candidate;
+
+    // Only a window of the good length can be corrected
+    if (decoder->Emitted || (decoder->Window.Length != FRAME_LENGTH))
+        return false;
+
+    // Keep the CORRECTION_BITS bits with the lowest confidence, sorted
+    for (int i = 0; i < FRAME_LENGTH; i++)
+    {
+        uint8_t Confidence = decoder->Confidence[i];
+        int Pos = Nb;
+
+        if (Confidence >= CORRECTION_CONFIDENCE)
+            continue;
+        // The checksum is never changed, nor trusted to check a correction when one of its bits is unreliable
+        else if (i >= CORRECTION_LAST_BIT)
+            return false;
+        else if (Nb < CORRECTION_BITS)
+            Nb++;
+        else if (Confidence >= decoder->Confidence[Weakest[Nb - 1]])
+            continue;
+        else
+            Pos = Nb - 1;
+
+        while ((Pos > 0) && (decoder->Confidence[Weakest[Pos - 1]] > Confidence))
+        {
+            Weakest[Pos] = Weakest[Pos - 1];
+            Pos--;
+        }
+        Weakest[Pos] = i;
+    }
+
+    // First received bit is the most significant one
+    uint64_t Mask[CORRECTION_BITS];
+    for (int i = 0; i < Nb; i++)
+        Mask[i] = 1ULL << (FRAME_LENGTH - 1 - Weakest[i]);
+
+    // Single flips, then dual flips : the correction is refused if it is not unique
+    for (int i = 0; (i < Nb) && (Found < 2); i++)
+        if (tryCorrection(Bits, Mask[i], &Candidate) && (Found++ == 0))
+            *frame = Candidate;
+
+    if (Found == 0)
+        for (int i = 0; (i < Nb) && (Found < 2); i++)
+            for (int j = i + 1; (j < Nb) && (Found < 2); j++)
+                if (tryCorrection(Bits, Mask[i] | Mask[j], &Candidate) && (Found++ == 0))
+                    *frame = Candidate;
+
+    if (Found != 1)
+        return false;
+
+    // A checksum of 8 bits is often matched by chance : only a plausible reading of a known transmitter is kept
+    const tKnownId *Known = findKnownId(decoder, frame->IdNumber);
+    if (!Known || (frame->Battery != Known->Battery) || (abs(frame->Pressure - Known->Pressure) > CORRECTION_MAX_STEP))
+    {
+        decoder->Stream.Refused++;
+        return false;
+    }
+
+    frame->Corrected = true;
+    decoder->Stream.Accepted++;
+    decoder->Stream.Corrected++;
+    decoder->Emitted = true;
+    decoder->FrameId = frame->IdNumber;
+    decoder->FramePressure = frame->Pressure;
+    decoder->FrameBattery = frame->Battery;
+
+    return true;
+}
+
+bool streamEndOfFrame(tStreamDecoder *decoder, tReject *reason)
+{
+    tFrame Frame;
+    tReject Reason;
+    bool Emitted = decoder->Emitted;
+
+    // Legacy decoding of the whole burst
+    if (!decodeFrame(decoder->Burst.Bits, decoder->Burst.Length, &Frame))
+        decoder->Gap.Rejected[rejectLength]++;
+    else if (!frameValid(&Frame, &Reason))
+        decoder->Gap.Rejected[Reason]++;
+    else
+        decoder->Gap.Accepted++;
+
+    // Streaming decoding : the frame has already been emitted if it was valid
+    if (!Emitted)
+    {
+        *reason = (decoder->Window.Length < FRAME_LENGTH) ? rejectLength : decoder->LastReject;
+        decoder->Stream.Rejected[*reason]++;
+    }
+    else
+    {
+        tKnownId *Known = knownId(decoder, decoder->FrameId);
+
+        Known->LastBurst = decoder->Bursts;
+        Known->Pressure = decoder->FramePressure;
+        Known->Battery = decoder->FrameBattery;
+
+        // Pauses of a burst known to come from this transmitter - adaptive mode only
+        for (int i = 0; i < decoder->NbPauses; i++)
+            updateTiming(&Known->Timing, decoder->Pauses[i]);
+    }
+    decoder->Bursts++;
+    decoder->NbPauses = 0;
+
+    decoder->Window.Bits = 0;
+    decoder->Window.Length = 0;
+    decoder->FixedMiss = 0;
+    decoder->Burst.Bits = 0;
+    decoder->Burst.Length = 0;
+    decoder->Emitted = false;
+    decoder->LastReject = rejectLength;
+
+    return Emitted;
+}
+
+const char *batteryText(tBattery battery)
+{
+    switch (battery)
+    {
+    case batteryGood:
+        return "Good";
+    case batteryLow:
+        return "Low";
+    case batteryCritical:
+        return "Critical";
+    default:
+        return "Unknown";
+    }
+}
+
+const char *rejectText(tReject reason)
+{
+    switch (reason)
+    {
+    case rejectLength:
+        return "Length";
+    case rejectChecksum:
+        return "Checksum";
+    case rejectId:
+        return "ID";
+    default:
+        return "Unknown";
+    }
+}
@@ -0,0 +1,193 @@
+#pragma once
+
+#include <stdint.h>
+
+// A frame is made of 58 bits, first received bit is the most significant one
+#define FRAME_LENGTH 58
+
+// Sinusoid 38khz during 1ms + Short pause 1ms is a 0
+// sinusoid 38khz during 1ms + long pause 2ms is a 1
+#define TIME_MIN_PULSE 400   // us - shorter delta is an edge of the carrier inside a burst
+#define TIME_MIN_0 800       // us
+#define TIME_MAX_0 1200      // us
+#define TIME_MIN_1 1800      // us
+#define TIME_MAX_1 2200      // us
+#define TIME_END_FRAME 15000 // us
+
+#define BIT_NONE -1
+
+// Adaptive windows : histogram of the pauses, re-centered on the 2 clusters every HISTOGRAM_UPDATE pauses
+#define HISTOGRAM_BIN 50       // us
+#define HISTOGRAM_BINS 64      // Up to 3.2ms
+#define HISTOGRAM_UPDATE 64    // # of pauses between 2 updates of the windows
+#define HISTOGRAM_MIN_COUNT 8  // Min # of pauses in a cluster to move its window
+#define TIME_MIDDLE_01 1500    // us - clusters of 0 are searched below, clusters of 1 above
+
+// Windows of each transmitter, learned on its own frames only : a burst not decoded with the shared windows
+// is decoded again with the windows of each transmitter, and kept if it gives the ID of this transmitter
+#define DECODER_IDS 8          // Transmitters known by the decoder, the one heard the longest ago is replaced
+#define BURST_PAUSES 128       // Pauses of a burst kept for a second decoding
+
+// Correction of a frame with a wrong checksum by flipping its least reliable bits
+// At most CORRECTION_BITS single flips + CORRECTION_BITS * (CORRECTION_BITS - 1) / 2 dual flips are tried
+// The bits of the checksum are never flipped and must all be reliable, the frame must come from a known
+// transmitter with the same battery and a pressure close to its last frame
+#define CORRECTION_BITS 6
+#define CORRECTION_CONFIDENCE 100 // us - only the bits closer than this to a limit of their window can be flipped
+#define CORRECTION_LAST_BIT 50    // Position of the first bit of the checksum in the frame
+#define CORRECTION_MAX_STEP 40    // Half of the pressure in PSI - from the last frame of the transmitter
+#define MAX_PRESSURE 2250 // Half of the pressure in PSI - 4500 PSI, ~310 bars
+
+typedef enum
+{
+    batteryGood = 0,
+    batteryLow,
+    batteryCritical,
+    batteryUnknown,
+} tBattery;
+
+// Result of the decoding of one frame - no pointer, no allocation
+typedef struct
+{
+    uint8_t Preamble;  // 2 bits
+    uint8_t Sync1;     // 4 bits
+    uint8_t Sync2;     // 4 bits
+    char ID[7];        // 6 digits, '!' when the code of a digit is unknown
+    bool IdValid;      // All the digits of the ID are known
+    uint32_t IdNumber; // ID as an integer when valid
+    int Pressure;      // Half of the pressure in PSI
+    tBattery Battery;  // Battery status of the transmitter
+    int ChecksumCalc;  // Sum of the 12 nibbles after the preamble
+    int ChecksumMsg;   // 8 last bits of the frame
+    bool ChecksumOk;
+    bool Corrected;    // Bits flipped by streamCorrect() : the reading may be wrong
+} tFrame;
+
+// Bits received since the last end of frame
+// Bits are shifted in from the right, only the last 64 are kept
+typedef struct
+{
+    uint64_t Bits;
+    int Length;
+} tFrameBits;
+
+// Reason of the rejection of a frame
+typedef enum
+{
+    rejectLength = 0,
+    rejectChecksum,
+    rejectId,
+    NB_REJECT,
+} tReject;
+
+typedef struct
+{
+    uint32_t Accepted;
+    uint32_t Resync;    // Accepted after dropping spurious leading bits
+    uint32_t Recovered; // Accepted thanks to the adaptive windows
+    uint32_t Retimed;   // Accepted with the windows of its transmitter
+    uint32_t Corrected; // Accepted after flipping 1 or 2 bits
+    uint32_t Refused;   // Single correction found, refused for an unknown ID or a pressure too far
+    uint32_t Rejected[NB_REJECT];
+} tDecoderStats;
+
+typedef enum
+{
+    decoderFixed = 0, // Windows TIME_MIN_x / TIME_MAX_x
+    decoderAdaptive,  // Windows learned from the histogram of the pauses
+} tDecoderMode;
+
+// Windows used to classify the pauses - the histogram slowly forgets the old pauses
+// so that the windows follow the transmitter currently heard
+typedef struct
+{
+    uint16_t Count[HISTOGRAM_BINS];
+    uint16_t NbPulses; // Since the last update
+    uint16_t Center0;  // us - 0 when not learned yet
+    uint16_t Center1;  // us
+    uint16_t Min0, Max0, Min1, Max1;
+} tTiming;
+
+typedef struct
+{
+    bool Used;
+    uint32_t Id;
+    uint32_t LastBurst; // Burst of its last frame
+    int Pressure;       // Of its last frame
+    tBattery Battery;
+    tTiming Timing;     // Learned on its frames only
+} tKnownId;
+
+// Frames are searched on a sliding window of the last 58 bits as soon as they are received
+// The end of frame (silence) is only used to reset the window and to count the rejections
+// The legacy decoder working on the whole burst at the end of frame is kept for comparison
+typedef struct
+{
+    tDecoderMode Mode;
+    tTiming Timing;
+    tFrameBits Window;    // Bits since the last end of frame or the last emitted frame
+    uint64_t FixedMiss;   // Bits of the window that the fixed windows would not have given
+    uint8_t Confidence[64]; // Distance in us to the nearest limit of the window, by position in the window
+    tFrameBits Burst;     // All the bits since the last end of frame, with the fixed windows
+    bool Emitted;         // A frame has been emitted since the last end of frame
+    tReject LastReject;   // Why the last window has been rejected
+    uint32_t Symbols[2];  // # of pauses classified as 0 and 1
+    uint32_t OutOfWindow; // # of pauses out of the windows
+    tDecoderStats Stream; // Streaming decoder
+    tDecoderStats Gap;    // Decoder on the end of frame
+    uint16_t Pauses[BURST_PAUSES]; // Pauses of the current burst - adaptive mode only
+    int NbPauses;
+    uint32_t Bursts;      // # of ends of frame
+    uint32_t FrameId;     // ID, pressure and battery of the frame emitted for the current burst
+    int FramePressure;
+    tBattery FrameBattery;
+    tKnownId Known[DECODER_IDS];
+} tStreamDecoder;
+
+// Duration of the pause to be pushed for an edge, 0 when the edge is inside a burst of carrier
+static inline __attribute__((always_inline)) uint16_t edgeToPulse(long delta)
+{
+    if (delta <= TIME_MIN_PULSE)
+        return 0;
+
+    return (delta > 0xFFFF) ? 0xFFFF : delta;
+}
+
+// Give the bit corresponding to the duration of a pause, BIT_NONE if out of the windows
+int classifyPulse(uint16_t delta);
+
+// Classify the pause and add the bit to the frame
+void addPulse(tFrameBits *frame, uint16_t delta);
+
+// Add the pause to the histogram, the windows are updated every HISTOGRAM_UPDATE pauses
+void updateTiming(tTiming *timing, uint16_t delta);
+
+// Give the bit with the learned windows, the fixed ones are used until the clusters are found
+int classifyPulse(const tTiming *timing, uint16_t delta);
+
+// Decode the 58 bits of a frame - return false if the length is not the good one
+bool decodeFrame(uint64_t bits, int length, tFrame *frame);
+
+// Check the decoded frame, return false and give the reason if it cannot be used
+// A digit of the ID with an unknown code rejects the frame (rejectId), even with a valid checksum :
+// the ID is the key of the transmitter and of its readings, and it anchors the sliding window
+bool frameValid(const tFrame *frame, tReject *reason);
+
+// Add the pause to the stream - return true with the frame when a valid frame ends with this pause
+bool streamPulse(tStreamDecoder *decoder, uint16_t delta, tFrame *frame);
+
+// Silence after a burst, to be called before streamCorrect() and streamEndOfFrame()
+// Return true with the frame if the pauses of the burst give a valid frame with the windows of its transmitter
+bool streamRetime(tStreamDecoder *decoder, tFrame *frame);
+
+// Silence after a burst, to be called before streamEndOfFrame()
+// Return true with the frame if the window of 58 bits can be fixed by flipping 1 or 2 unreliable bits
+bool streamCorrect(tStreamDecoder *decoder, tFrame *frame);
+
+// Silence after a burst - return false with the reason if no frame has been emitted for this burst
+// The windows of the transmitter of the frame emitted learn the pauses of the burst
+bool streamEndOfFrame(tStreamDecoder *decoder, tReject *reason);
+
+const char *batteryText(tBattery battery);
+
+const char *rejectText(tReject reason);
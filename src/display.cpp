@@ -1,6 +1,7 @@
 #include <Arduino.h>
 #include <Adafruit_SSD1306.h>
 #include "display.h"
+#include "metrics.h"
 
 #define OLED_RESET -1       // Reset pin # (or -1 if sharing Arduino reset pin)
 #define SCREEN_ADDRESS 0x3c ///< See datasheet for Address; 0x3D for 128x64, 0x3C for 128x32
@@ -9,31 +10,104 @@
 
 #define SCREEN_WIDTH 128 // OLED display width, in pixels
 #define SCREEN_HEIGHT 64 // OLED display height, in pixels
+#define SCREEN_PAGES (SCREEN_HEIGHT / 8)
 
-Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET);
+#define I2C_CLOCK 1000000 // Hz - fast mode plus
+#define I2C_CHUNK 64      // Max # of bytes of data in one I2C transmission
 
+// The screen is powered with the receiver : it is probed until it answers, 2 + 4 + ... + 64 ms at most
+#define DISPLAY_BEGIN_TRIES 7
+
+Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET, I2C_CLOCK, I2C_CLOCK);
+
+// Columns to be sent for each page of the screen (8 lines of pixels), in the orientation of the controller
+int dirtyMin[SCREEN_PAGES];
+int dirtyMax[SCREEN_PAGES];
+
+// Statistics of the flushes since the last call to displayStats()
+unsigned long flushBytes = 0;
+unsigned long flushMicros = 0;
+
+// Mark a rectangle of the screen (rotated coordinates) to be sent by flushDisplay()
+void markDirty(int x, int y, int w, int h)
+{
+    // Clip on the screen
+    if (x < 0)
+    {
+        w += x;
+        x = 0;
+    }
+    if (y < 0)
+    {
+        h += y;
+        y = 0;
+    }
+    if (x + w > SCREEN_WIDTH)
+        w = SCREEN_WIDTH - x;
+    if (y + h > SCREEN_HEIGHT)
+        h = SCREEN_HEIGHT - y;
+    if ((w <= 0) || (h <= 0))
+        return;
+
+    // Screen is rotated by 180 degrees (setRotation(2))
+    int px = SCREEN_WIDTH - x - w;
+    int py = SCREEN_HEIGHT - y - h;
+
+    for (int page = py / 8; page <= (py + h - 1) / 8; page++)
+    {
+        if (px < dirtyMin[page])
+            dirtyMin[page] = px;
+        if (px + w - 1 > dirtyMax[page])
+            dirtyMax[page] = px + w - 1;
+    }
+}
+
+void clearDirty()
+{
+    for (int page = 0; page < SCREEN_PAGES; page++)
+    {
+        dirtyMin[page] = SCREEN_WIDTH;
+        dirtyMax[page] = -1;
+    }
+}
+
+void sendCommands(const uint8_t *commands, int nb)
+{
+    Wire.beginTransmission(SCREEN_ADDRESS);
+    Wire.write((uint8_t)0x00); // Co = 0, D/C = 0 : commands
+    Wire.write(commands, nb);
+    Wire.endTransmission();
+
+    flushBytes += nb + 1;
+}
+
+// The separation line is drawn again by each clear, it is only sent by the first flush after initDisplay()
 void clearBottom()
 {
     display.fillRect(0, 48, 128, 16, BLACK);
     display.drawLine(0, 47, 128, 47, WHITE);
+    markDirty(0, 48, 128, 16);
 }
 
 void clearBottomLeft()
 {
     display.fillRect(0, 48, 94, 16, BLACK);
     display.drawLine(0, 47, 128, 47, WHITE);
+    markDirty(0, 48, 94, 16);
 }
 
 void clearBottomRight()
 {
     display.fillRect(95, 48, 128 - 95, 16, BLACK);
     display.drawLine(0, 47, 128, 47, WHITE);
+    markDirty(95, 48, 128 - 95, 16);
 }
 
 void clearMain()
 {
     display.fillRect(0, 0, 128, 47, BLACK);
     display.drawLine(0, 47, 128, 47, WHITE);
+    markDirty(0, 0, 128, 47);
 }
 
 void displayText(tZone zone, int size, const char *format, ...)
@@ -88,7 +162,59 @@ void displayText(tZone zone, int size, const char *format, ...)
     display.setTextSize(size);
     display.setCursor(x, y);
     display.printf(buffer);
-    display.display();
+
+    // Text can go out of its zone
+    int16_t x1, y1;
+    uint16_t w, h;
+    display.getTextBounds(buffer, x, y, &x1, &y1, &w, &h);
+    markDirty(x1, y1, w, h);
+}
+
+void flushDisplay()
+{
+    unsigned long Start = micros();
+    unsigned long Bytes = flushBytes;
+    uint8_t *Buffer = display.getBuffer();
+
+    for (int page = 0; page < SCREEN_PAGES; page++)
+    {
+        if (dirtyMax[page] < 0)
+            continue;
+
+        // Window of the controller on the dirty columns of the page, horizontal addressing mode set by begin()
+        const uint8_t Commands[] = {SSD1306_COLUMNADDR, (uint8_t)dirtyMin[page], (uint8_t)dirtyMax[page],
+                                    SSD1306_PAGEADDR, (uint8_t)page, (uint8_t)page};
+        sendCommands(Commands, sizeof(Commands));
+
+        for (int col = dirtyMin[page]; col <= dirtyMax[page]; col += I2C_CHUNK)
+        {
+            int Nb = dirtyMax[page] + 1 - col;
+            if (Nb > I2C_CHUNK)
+                Nb = I2C_CHUNK;
+
+            Wire.beginTransmission(SCREEN_ADDRESS);
+            Wire.write((uint8_t)0x40); // Co = 0, D/C = 1 : data
+            Wire.write(&Buffer[page * SCREEN_WIDTH + col], Nb);
+            Wire.endTransmission();
+
+            flushBytes += Nb + 1;
+        }
+    }
+
+    clearDirty();
+
+    if (flushBytes != Bytes)
+        observeMetric(histogramFlush, micros() - Start);
+    flushMicros += micros() - Start;
+}
+
+void displayStats(unsigned long *bytes, unsigned long *us)
+{
+    *bytes = flushBytes;
+    *us = flushMicros;
+
+    flushBytes = 0;
+    flushMicros = 0;
 }
 
 void deactivateDisplay()
@@ -105,15 +231,28 @@ void initDisplay()
     pinMode(I2C_SCL, INPUT_PULLUP);
     Wire.begin(I2C_SDA, I2C_SCL);
 
-    if (!display.begin(SSD1306_SWITCHCAPVCC, SCREEN_ADDRESS))
+    clearDirty();
+
+    // The init sequence is only sent once the screen acknowledges its address
+    bool Ready = false;
+    for (int Try = 0; (Try < DISPLAY_BEGIN_TRIES) && !Ready; Try++)
     {
-        Serial.println(F("Display init failed"));
-        for (;;)
-            ; // Don't proceed, loop forever
+        if (Try > 0)
+            delay(1 << Try);
+
+        Wire.beginTransmission(SCREEN_ADDRESS);
+        Ready = (Wire.endTransmission() == 0) && display.begin(SSD1306_SWITCHCAPVCC, SCREEN_ADDRESS);
     }
 
-    delay(500);
+    // The receiver goes on without the screen, but nothing can be drawn without the buffer of begin()
+    if (!Ready)
+    {
+        Serial.println(F("Display init failed"));
+        if ((display.getBuffer() == nullptr) && !display.begin(SSD1306_SWITCHCAPVCC, SCREEN_ADDRESS))
+            ESP.restart();
+    }
 
+    // Nothing to wait for : begin() has reset the screen and sent its init sequence
     display.clearDisplay();
     display.setCursor(0, 0);
     display.setRotation(2);
@@ -121,5 +260,7 @@ void initDisplay()
 
     displayText(bottomLeftHigh, 2, "Booting ...");
 
+    // Whole screen once, then only the modified parts
     display.display();
+    clearDirty();
 }
\ No newline at end of file
@@ -20,8 +20,15 @@ void clearBottomRight();
 
 void clearMain();
 
+// Draw the text in the buffer of the screen, it is sent by flushDisplay()
 void displayText(tZone zone, int size, const char *format, ...);
 
+// Send to the screen the parts modified since the last flush
+void flushDisplay();
+
+// Bytes sent on the I2C bus and time spent in flushDisplay() since the last call
+void displayStats(unsigned long *bytes, unsigned long *us);
+
 void deactivateDisplay();
 
 void initDisplay();
@@ -0,0 +1,108 @@
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+#include "events.h"
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+int addEventClient(tEventRing *ring, int socket)
+{
+    for (int i = 0; i < EVENT_CLIENTS; i++)
+    {
+        tEventClient *c = &ring->Client[i];
+
+        if (!c->Used)
+        {
+            c->Used = true;
+            c->Socket = socket;
+            c->Cursor = ring->Head;
+            c->Offset = 0;
+            c->Dropped = 0;
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+void publishEvent(tEventRing *ring, const char *text, int length, unsigned long time)
+{
+    int Index = ring->Head & (EVENT_QUEUE - 1);
+
+    if (length > EVENT_LENGTH)
+        length = EVENT_LENGTH;
+
+    memcpy(ring->Text[Index], text, length);
+    ring->Length[Index] = length;
+    ring->Time[Index] = time;
+    ring->Head++;
+}
+
+// Returns false when the socket is closed
+static bool pumpClient(tEventRing *ring, tEventClient *c, unsigned long now)
+{
+    // Events overwritten before being sent are lost, the client restarts at the oldest one
+    if (ring->Head - c->Cursor > EVENT_QUEUE)
+    {
+        uint32_t Lost = ring->Head - c->Cursor - EVENT_QUEUE;
+
+        c->Dropped += Lost;
+        ring->Dropped += Lost;
+
+        // The end of a partially sent event is gone : the stream cannot be resumed,
+        // the client is closed and the browser reconnects by itself
+        if (c->Offset > 0)
+            return false;
+
+        c->Cursor = ring->Head - EVENT_QUEUE;
+    }
+
+    while (c->Cursor != ring->Head)
+    {
+        int Index = c->Cursor & (EVENT_QUEUE - 1);
+        int Length = ring->Length[Index] - c->Offset;
+
+        ssize_t n = send(c->Socket, ring->Text[Index] + c->Offset, Length, MSG_DONTWAIT | MSG_NOSIGNAL);
+
+        if (n < 0)
+            return (errno == EAGAIN) || (errno == EWOULDBLOCK);
+
+        c->Offset += n;
+        if (n < Length)
+            return true;
+
+        if (ring->Time[Index] != 0)
+        {
+            ring->Delivered++;
+            if (now - ring->Time[Index] > ring->MaxLatency)
+                ring->MaxLatency = now - ring->Time[Index];
+        }
+
+        c->Cursor++;
+        c->Offset = 0;
+    }
+
+    return true;
+}
+
+int pumpEvents(tEventRing *ring, unsigned long now)
+{
+    int Nb = 0;
+
+    for (int i = 0; i < EVENT_CLIENTS; i++)
+    {
+        tEventClient *c = &ring->Client[i];
+
+        if (!c->Used)
+            continue;
+
+        if (pumpClient(ring, c, now))
+            Nb++;
+        else
+            c->Used = false;
+    }
+
+    return Nb;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdint.h>
+
+// Fan-out of the readings to the browsers (Server-Sent Events)
+// Every event is formatted once in a ring, each client has its own cursor in it
+// Sockets are written without waiting : a slow client loses events, it never blocks the others
+#define EVENT_QUEUE 16    // Power of 2
+#define EVENT_LENGTH 192  // Longest event, SSE framing included
+#define EVENT_CLIENTS 4
+
+typedef struct
+{
+    bool Used;
+    int Socket;
+    uint32_t Cursor;  // Next event to send
+    int Offset;       // Bytes of this event already sent
+    uint32_t Dropped; // # of events lost because the client was too slow
+} tEventClient;
+
+typedef struct
+{
+    char Text[EVENT_QUEUE][EVENT_LENGTH];
+    int Length[EVENT_QUEUE];
+    unsigned long Time[EVENT_QUEUE]; // Last bit of the frame, 0 if not a frame - us
+    uint32_t Head;                   // # of events published
+    tEventClient Client[EVENT_CLIENTS];
+    uint32_t Dropped;                // # of events lost, all clients
+    uint32_t Delivered;              // # of frames fully written to a client
+    unsigned long MaxLatency;        // From the last bit of the frame to the socket - us
+} tEventRing;
+
+// Client will receive the events published from now on - returns its slot, -1 if all are used
+int addEventClient(tEventRing *ring, int socket);
+
+// Copy an event already formatted for SSE ("id: ...\ndata: ...\n\n")
+void publishEvent(tEventRing *ring, const char *text, int length, unsigned long time);
+
+// Write what each socket accepts without blocking - a client whose socket is closed is removed
+// Returns the # of clients
+int pumpEvents(tEventRing *ring, unsigned long now);
@@ -0,0 +1,309 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "flashlog.h"
+
+// Segment file : header + records
+typedef struct
+{
+    uint32_t Magic;
+    uint32_t FirstNum;
+} tLogHeader;
+
+static uint32_t crc32(const void *data, size_t length)
+{
+    const uint8_t *p = (const uint8_t *)data;
+    uint32_t Crc = 0xFFFFFFFF;
+
+    while (length--)
+    {
+        Crc ^= *p++;
+        for (int i = 0; i < 8; i++)
+            Crc = (Crc >> 1) ^ (0xEDB88320 & (0 - (Crc & 1)));
+    }
+
+    return ~Crc;
+}
+
+static inline uint64_t idBit(uint32_t id)
+{
+    return 1ULL << ((id * 2654435761u) >> 26);
+}
+
+static void segmentPath(const tLog *log, int slot, char *path, size_t size)
+{
+    snprintf(path, size, "%s/seg%02d", log->Dir, slot);
+}
+
+// Add a reading to the index entry of its segment
+static void indexReading(tLogIndex *index, tRecord record)
+{
+    uint32_t Time = record & 0x3FFFFFFF;
+    tReading r;
+
+    unpackReading(record, &r);
+
+    if ((index->Count == 0) || (Time < index->MinTime))
+        index->MinTime = Time;
+    if ((index->Count == 0) || (Time > index->MaxTime))
+        index->MaxTime = Time;
+    index->IdMask |= idBit(r.Id);
+    index->Count++;
+}
+
+static bool writeIndex(const tLog *log, int slot)
+{
+    char Path[48];
+    snprintf(Path, sizeof(Path), "%s/index", log->Dir);
+
+    FILE *f = fopen(Path, "r+b");
+    if (f == nullptr)
+    {
+        // First use : every slot is written
+        f = fopen(Path, "w+b");
+        if (f == nullptr)
+            return false;
+        fwrite(log->Index, sizeof(log->Index), 1, f);
+    }
+    else
+    {
+        fseek(f, slot * sizeof(tLogIndex), SEEK_SET);
+        fwrite(&log->Index[slot], sizeof(tLogIndex), 1, f);
+    }
+
+    fclose(f);
+    return true;
+}
+
+// Read the records of the segment again, up to the first one not complete or with a wrong CRC
+// The file is cut there, so that the next readings are appended right after the last valid one
+static void recoverSegment(tLog *log, int slot)
+{
+    tLogIndex *Index = &log->Index[slot];
+    char Path[48];
+    tLogHeader Header;
+    tLogRecord Record;
+    struct stat Stat;
+
+    segmentPath(log, slot, Path, sizeof(Path));
+
+    uint32_t FirstNum = Index->FirstNum;
+    Index->Count = 0;
+    Index->IdMask = 0;
+
+    FILE *f = fopen(Path, "rb");
+    if (f == nullptr)
+        return;
+
+    long Valid = 0;
+    if ((fread(&Header, sizeof(Header), 1, f) == 1) && (Header.Magic == LOG_MAGIC) && (Header.FirstNum == FirstNum))
+    {
+        Valid = sizeof(Header);
+        while ((fread(&Record, sizeof(Record), 1, f) == 1) && (Record.Crc == crc32(&Record.Reading, sizeof(tRecord))))
+        {
+            indexReading(Index, Record.Reading);
+            Valid += sizeof(Record);
+        }
+    }
+    fclose(f);
+
+    if ((stat(Path, &Stat) == 0) && (Stat.st_size > Valid))
+    {
+        log->Recovered += Stat.st_size - Valid;
+        if (Valid == 0)
+            remove(Path);
+        else
+            truncate(Path, Valid);
+    }
+}
+
+bool openLog(tLog *log, const char *dir)
+{
+    char Path[48];
+
+    memset(log, 0, sizeof(*log));
+    snprintf(log->Dir, sizeof(log->Dir), "%s", dir);
+    mkdir(dir, 0755);
+
+    snprintf(Path, sizeof(Path), "%s/index", dir);
+    FILE *f = fopen(Path, "rb");
+    if (f != nullptr)
+    {
+        if (fread(log->Index, sizeof(log->Index), 1, f) != 1)
+            memset(log->Index, 0, sizeof(log->Index));
+        fclose(f);
+    }
+
+    // Segment written last
+    for (int i = 0; i < LOG_SEGMENTS; i++)
+        if (log->Index[i].Segment > log->Index[log->Active].Segment)
+            log->Active = i;
+
+    // The index of the last segment can be late on its content, or ahead of it if the reset happened during a write
+    if (log->Index[log->Active].Segment != 0)
+    {
+        recoverSegment(log, log->Active);
+        writeIndex(log, log->Active);
+    }
+
+    log->Open = true;
+    return true;
+}
+
+uint32_t nextLogNum(const tLog *log)
+{
+    const tLogIndex *Index = &log->Index[log->Active];
+
+    return Index->FirstNum + Index->Count;
+}
+
+// Start the next segment, the oldest one is overwritten
+// The index is written before the file : after a reset the segment is found, even empty
+static bool newSegment(tLog *log, uint32_t firstNum)
+{
+    int Slot = (log->Index[log->Active].Segment == 0) ? log->Active : (log->Active + 1) % LOG_SEGMENTS;
+    tLogIndex *Index = &log->Index[Slot];
+    char Path[48];
+
+    memset(Index, 0, sizeof(*Index));
+    Index->Segment = log->Index[log->Active].Segment + 1;
+    Index->FirstNum = firstNum;
+    log->Active = Slot;
+
+    if (!writeIndex(log, Slot))
+        return false;
+
+    tLogHeader Header = {LOG_MAGIC, firstNum};
+
+    segmentPath(log, Slot, Path, sizeof(Path));
+    FILE *f = fopen(Path, "wb");
+    if (f == nullptr)
+        return false;
+
+    bool Ok = (fwrite(&Header, sizeof(Header), 1, f) == 1);
+    fclose(f);
+
+    return Ok;
+}
+
+int appendLog(tLog *log, const tHistory *h, uint32_t num)
+{
+    tLogRecord Records[64];
+    int Written = 0;
+
+    if (num < historyOldest(h))
+        num = historyOldest(h);
+
+    while (num < h->Count)
+    {
+        tLogIndex *Index = &log->Index[log->Active];
+
+        // Readings lost in between (reset, history overwritten) : the numbers of a segment must follow each other
+        if ((Index->Segment == 0) || (Index->Count >= LOG_SEGMENT_READINGS) || (num != nextLogNum(log)))
+        {
+            if (!newSegment(log, num))
+                break;
+            Index = &log->Index[log->Active];
+        }
+
+        // Readings written by blocks, up to the end of the segment
+        int Nb = 0;
+        while ((Nb < 64) && (num + Nb < h->Count) && (Index->Count + Nb < LOG_SEGMENT_READINGS))
+        {
+            Records[Nb].Reading = h->Records[(num + Nb) % HISTORY_LENGTH];
+            Records[Nb].Crc = crc32(&Records[Nb].Reading, sizeof(tRecord));
+            Nb++;
+        }
+
+        char Path[48];
+        segmentPath(log, log->Active, Path, sizeof(Path));
+
+        FILE *f = fopen(Path, "ab");
+        if (f == nullptr)
+            break;
+        int Done = fwrite(Records, sizeof(tLogRecord), Nb, f);
+        fclose(f);
+
+        for (int i = 0; i < Done; i++)
+            indexReading(Index, Records[i].Reading);
+
+        num += Done;
+        Written += Done;
+
+        if (Done < Nb)
+            break;
+    }
+
+    if (Written > 0)
+        writeIndex(log, log->Active);
+
+    return Written;
+}
+
+int queryLog(tLog *log, time_t from, time_t to, uint32_t id, tLogCallback callback, void *context, int *read)
+{
+    int Found = 0;
+    *read = 0;
+
+    if (to < HISTORY_EPOCH)
+        return 0;
+
+    uint32_t From = (from > HISTORY_EPOCH) ? from - HISTORY_EPOCH : 0;
+    uint32_t To = to - HISTORY_EPOCH;
+
+    // From the oldest segment to the newest one
+    for (int n = 1; n <= LOG_SEGMENTS; n++)
+    {
+        int Slot = (log->Active + n) % LOG_SEGMENTS;
+        const tLogIndex *Index = &log->Index[Slot];
+
+        if ((Index->Segment == 0) || (Index->Count == 0))
+            continue;
+        if ((Index->MaxTime < From) || (Index->MinTime > To))
+            continue;
+        if ((id != 0) && !(Index->IdMask & idBit(id)))
+            continue;
+
+        char Path[48];
+        segmentPath(log, Slot, Path, sizeof(Path));
+
+        FILE *f = fopen(Path, "rb");
+        if (f == nullptr)
+            continue;
+
+        fseek(f, sizeof(tLogHeader), SEEK_SET);
+
+        tLogRecord Records[64];
+        uint32_t Num = Index->FirstNum;
+        uint32_t Left = Index->Count;
+
+        while (Left > 0)
+        {
+            int Nb = fread(Records, sizeof(tLogRecord), (Left < 64) ? Left : 64, f);
+            if (Nb <= 0)
+                break;
+
+            for (int i = 0; i < Nb; i++, Num++)
+            {
+                tReading r;
+
+                unpackReading(Records[i].Reading, &r);
+                r.Num = Num;
+
+                if ((r.Time >= from) && (r.Time <= to) && ((id == 0) || (r.Id == id)))
+                {
+                    callback(&r, context);
+                    Found++;
+                }
+            }
+
+            Left -= Nb;
+            *read += Nb;
+        }
+
+        fclose(f);
+    }
+
+    return Found;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stdint.h>
+#include "history.h"
+
+// Long-term history : append-only log of the readings on the flash file system
+// The log is made of LOG_SEGMENTS files used in turn, the oldest one is overwritten when the last one is full
+// Only stdio is used : /littlefs on the ESP32, any directory on the host
+#define LOG_SEGMENTS 16            // 16 x 1024 readings, 192 kB of flash
+#define LOG_SEGMENT_READINGS 1024
+#define LOG_MAGIC 0x4C38484D       // "MH8L"
+
+// Record in a segment : packed reading + CRC32 of it - 12 bytes
+// The number of a reading is not stored : readings of a segment have consecutive numbers
+typedef struct __attribute__((packed))
+{
+    tRecord Reading;
+    uint32_t Crc;
+} tLogRecord;
+
+// Sparse index : one entry per segment, the segments outside of the query are not read
+typedef struct
+{
+    uint32_t Segment;  // Sequence # of the segment + 1, 0 when the slot is empty
+    uint32_t FirstNum; // Number of the first reading
+    uint32_t Count;    // # of readings
+    uint32_t MinTime;  // Since HISTORY_EPOCH - s
+    uint32_t MaxTime;
+    uint32_t Reserved;
+    uint64_t IdMask;   // Bloom filter of the IDs : one bit per ID hash
+} tLogIndex;
+
+typedef struct
+{
+    char Dir[32];
+    bool Open;
+    int Active;                    // Slot of the segment being written
+    tLogIndex Index[LOG_SEGMENTS];
+    uint32_t Recovered;            // Bytes dropped at the end of the last segment when it was opened
+} tLog;
+
+// Read the index and check the last segment : a record torn by a reset is removed
+bool openLog(tLog *log, const char *dir);
+
+// Number the next reading must have to be appended to the current segment
+uint32_t nextLogNum(const tLog *log);
+
+// Append the readings of the history from num to the newest one - returns the # of readings written
+int appendLog(tLog *log, const tHistory *h, uint32_t num);
+
+// Call back for every reading between from and to (included), only for one ID if id != 0
+// Returns the # of readings found, *read the # of readings read from the flash
+typedef void (*tLogCallback)(const tReading *reading, void *context);
+int queryLog(tLog *log, time_t from, time_t to, uint32_t id, tLogCallback callback, void *context, int *read);
@@ -0,0 +1,58 @@
+#include <math.h>
+#include "framesync.h"
+#include "metrics.h"
+
+static inline float guardTime(const tFrameSync *s)
+{
+    return SYNC_GUARD + 4 * s->Deviation;
+}
+
+void syncFrame(tFrameSync *s, uint32_t now)
+{
+    uint32_t Interval = now - s->Last;
+    bool First = (s->Last == 0) && (s->Period == 0) && (s->Locked == 0);
+
+    s->Last = now;
+    if (First)
+        return;
+
+    // Several periods when frames have been lost in between
+    int k = (s->Period > 0) ? lroundf(Interval / s->Period) : 0;
+    float Error = Interval - k * s->Period;
+
+    if ((k >= 1) && (fabsf(Error) < SYNC_TOLERANCE + 4 * s->Deviation))
+    {
+        s->Period += SYNC_WEIGHT * Error / k;
+        s->Deviation += SYNC_WEIGHT * (fabsf(Error) - s->Deviation);
+
+        // Frames expected in between and not received
+        if (k > 1)
+        {
+            s->Missed += k - 1;
+            countMetric(metricSyncMissed, k - 1);
+            s->Locked = 0;
+        }
+        if (s->Locked < 255)
+            s->Locked++;
+        return;
+    }
+
+    // Period not known yet, or changed
+    s->Period = ((Interval >= SYNC_MIN_PERIOD) && (Interval <= SYNC_MAX_PERIOD)) ? Interval : 0;
+    s->Deviation = 0;
+    s->Locked = 0;
+}
+
+uint32_t frameSleepTime(const tFrameSync *s, uint32_t now)
+{
+    uint32_t Since = now - s->Last;
+    float Guard = guardTime(s);
+
+    // Period not known, or window of the next frame over without it
+    if ((s->Locked < SYNC_LOCK) || (Since > s->Period + Guard))
+        return (Since < SYNC_FORGET) ? 0 : SYNC_FOREVER;
+
+    float Wake = s->Period - SYNC_FRAME_TIME - Guard;
+
+    return (Since >= Wake) ? 0 : (uint32_t)(Wake - Since);
+}
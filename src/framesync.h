@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdint.h>
+
+// Period and phase of the frames of a transmitter, learned from the frames received
+// Once they are known, the receiver can sleep until just before the next frame of each transmitter
+// A frame missed, a new transmitter : the receiver listens all the time until the period is known again
+#define SYNC_MIN_PERIOD 500     // ms
+#define SYNC_MAX_PERIOD 30000   // ms
+#define SYNC_TOLERANCE 60       // ms - interval taken as a multiple of the period, plus 4 x the deviation
+#define SYNC_WEIGHT 0.125f      // Weight of a new interval in the period and the deviation
+#define SYNC_LOCK 3             // Intervals in a row matching the period before sleeping
+#define SYNC_FRAME_TIME 200     // ms - from the start of a frame to its decoding
+#define SYNC_GUARD 40           // ms - awake before the start of the frame and after its end, plus 4 x the deviation
+#define SYNC_FORGET 30000       // ms - transmitter not locked and not received : no longer kept awake for it
+#define SYNC_LISTEN 12000       // ms - awake after the carrier has woken the receiver up : new transmitter
+#define SYNC_FOREVER 0xFFFFFFFF // No limit from this transmitter
+
+typedef struct
+{
+    uint32_t Last;   // ms - last frame decoded
+    float Period;    // ms, 0 until known
+    float Deviation; // ms - mean error of the prediction
+    uint8_t Locked;  // Intervals in a row matching the period
+    uint32_t Missed; // Frames expected and not received
+} tFrameSync;
+
+// Frame decoded at now, time of its capture - ms
+// Frames missed since the last one are counted, the period is then learned again before sleeping
+void syncFrame(tFrameSync *s, uint32_t now);
+
+// Time the receiver can sleep before the next frame - ms, 0 to listen, SYNC_FOREVER when there is no limit
+// Once the window of the next frame is over without it, the receiver listens
+uint32_t frameSleepTime(const tFrameSync *s, uint32_t now);
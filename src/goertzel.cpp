@@ -0,0 +1,118 @@
+#include <math.h>
+#include "goertzel.h"
+#include "decoder.h"
+
+#define BLOCK_TICKS (CARRIER_BLOCK * CARRIER_TICKS)
+
+static inline uint32_t ticksToUs(uint32_t ticks)
+{
+    return (uint64_t)ticks * 1000000 / (CARRIER_RATE * CARRIER_TICKS);
+}
+
+void initCarrierDetector(tCarrierDetector *d)
+{
+    *d = tCarrierDetector();
+
+    for (int n = 0; n < CARRIER_BLOCK; n++)
+    {
+        d->Cos[n] = cosf(2 * (float)M_PI * CARRIER_FREQUENCY * n / CARRIER_RATE);
+        d->Sin[n] = sinf(2 * (float)M_PI * CARRIER_FREQUENCY * n / CARRIER_RATE);
+    }
+
+    d->Floor = CARRIER_MIN_LEVEL / CARRIER_SNR;
+}
+
+float carrierAmplitude(tCarrierDetector *d, const int16_t *samples)
+{
+    float Mean = 0;
+    for (int n = 0; n < CARRIER_BLOCK; n++)
+        Mean += samples[n];
+    Mean /= CARRIER_BLOCK;
+
+    // Offset of the ADC removed, it would leak in the bin of the carrier
+    float Re = 0, Im = 0;
+    for (int n = 0; n < CARRIER_BLOCK; n++)
+    {
+        float x = samples[n] - Mean;
+        Re += x * d->Cos[n];
+        Im += x * d->Sin[n];
+    }
+
+    float SumRe = Re + d->Re;
+    float SumIm = Im + d->Im;
+
+    d->Re = Re;
+    d->Im = Im;
+
+    return sqrtf(SumRe * SumRe + SumIm * SumIm) * (1.0f / CARRIER_BLOCK);
+}
+
+// Time where the amplitude crossed the level, between the previous block and this one - ticks
+static uint32_t crossingTime(const tCarrierDetector *d, float amplitude, float level)
+{
+    float Ratio = (amplitude != d->Last) ? (level - d->Last) / (amplitude - d->Last) : 1;
+
+    return d->Time - lroundf(BLOCK_TICKS * (1 - Ratio));
+}
+
+int detectCarrier(tCarrierDetector *d, const int16_t *samples, int nb, uint16_t *pauses, int max)
+{
+    int Nb = 0;
+
+    for (int i = 0; i < nb; i++)
+    {
+        d->Block[d->Fill++] = samples[i];
+        if (d->Fill < CARRIER_BLOCK)
+            continue;
+
+        d->Fill = 0;
+        d->Time += BLOCK_TICKS;
+
+        float Amplitude = carrierAmplitude(d, d->Block);
+        float High = fmaxf(fmaxf(d->Floor * CARRIER_SNR, (d->Floor + d->Peak) / 2), CARRIER_MIN_LEVEL);
+        float Low = High * CARRIER_HYSTERESIS;
+
+        if (!d->Burst && (Amplitude > High))
+        {
+            d->Burst = true;
+            d->BurstPeak = 0;
+            d->RiseTime = crossingTime(d, Amplitude, High);
+        }
+        else if (d->Burst && (Amplitude < Low))
+        {
+            uint32_t Fall = crossingTime(d, Amplitude, Low);
+
+            d->Burst = false;
+            d->Quiet = 0;
+
+            // Burst long enough : the pause before it is given, else the pause goes on
+            if (ticksToUs(Fall - d->RiseTime) >= CARRIER_MIN_BURST)
+            {
+                uint16_t Pulse = edgeToPulse(ticksToUs(d->RiseTime - d->FallTime));
+
+                if (Pulse && (Nb < max))
+                    pauses[Nb++] = Pulse;
+
+                d->FallTime = Fall;
+                d->Peak += CARRIER_PEAK_WEIGHT * (d->BurstPeak - d->Peak);
+            }
+        }
+
+        if (d->Burst)
+            d->BurstPeak = fmaxf(d->BurstPeak, Amplitude);
+        else if (++d->Quiet > 2)
+        {
+            // Noise alone, clipped to twice the floor against the glitches
+            d->Floor += CARRIER_FLOOR_WEIGHT * (fminf(Amplitude, fmaxf(2 * d->Floor, CARRIER_MIN_LEVEL)) - d->Floor);
+        }
+
+        d->Last = Amplitude;
+    }
+
+    return Nb;
+}
+
+uint32_t carrierSilence(const tCarrierDetector *d)
+{
+    return d->Burst ? 0 : ticksToUs(d->Time - d->FallTime);
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stdint.h>
+
+// Detection of the 38 kHz carrier in the samples of the ADC, for the boards without the op-amp
+// The samples are cut in blocks, the carrier in each block is the one given by Goertzel, computed as
+// a correlation with a sine and a cosine (same result, no dependency between 2 samples)
+// A block is ~5 periods of the carrier : its phase goes on from one block to the next, so that the amplitude
+// is taken over the last 2 blocks for less noise, and still updated after each block
+// The amplitude takes 2 blocks to rise and to fall : the threshold is at half of the amplitude of the carrier,
+// so that the start and the end of a burst are delayed the same way and the pauses are right
+#define CARRIER_RATE 83333         // Hz - fastest sampling of the ADC of the ESP32-S3, 38 kHz is below Nyquist
+#define CARRIER_FREQUENCY 38000    // Hz
+#define CARRIER_BLOCK 11           // Samples - 132 us, 5.016 periods of the carrier
+#define CARRIER_SNR 3.0f           // Lowest threshold = noise floor x SNR
+#define CARRIER_HYSTERESIS 0.8f    // End of a burst below threshold x hysteresis
+#define CARRIER_MIN_LEVEL 20.0f    // Lowest threshold, in ADC steps
+#define CARRIER_MIN_BURST 400      // us - shorter bursts are noise, the pause goes on
+#define CARRIER_FLOOR_WEIGHT 0.02f // Noise floor follows the amplitude outside of the bursts
+#define CARRIER_PEAK_WEIGHT 0.25f  // Amplitude of the carrier follows the highest one of each burst
+
+// Times are counted in 1/16 of sample, and wrap after ~50 min : only their differences are used
+#define CARRIER_TICKS 16
+
+typedef struct
+{
+    float Cos[CARRIER_BLOCK];
+    float Sin[CARRIER_BLOCK];
+    float Re, Im;       // Carrier in the previous block
+    float Last;         // Amplitude over the previous blocks
+    float Floor;        // Amplitude of the noise
+    float Peak;         // Amplitude of the carrier
+    float BurstPeak;    // Highest amplitude in the current burst
+    bool Burst;         // Carrier present
+    int Quiet;          // Blocks since the end of the last burst
+    uint32_t Time;      // End of the last block - ticks
+    uint32_t RiseTime;  // Start of the current burst - ticks
+    uint32_t FallTime;  // End of the last burst - ticks
+    int Fill;           // Samples in the current block
+    int16_t Block[CARRIER_BLOCK];
+} tCarrierDetector;
+
+void initCarrierDetector(tCarrierDetector *d);
+
+// Amplitude of the carrier over this block and the previous one
+float carrierAmplitude(tCarrierDetector *d, const int16_t *samples);
+
+// Process the samples, the pauses before each burst are given as the interrupt would give them,
+// once the burst is over - returns the # of pauses written
+int detectCarrier(tCarrierDetector *d, const int16_t *samples, int nb, uint16_t *pauses, int max);
+
+// Time since the end of the last burst, at the last sample processed - us
+uint32_t carrierSilence(const tCarrierDetector *d);
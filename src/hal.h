@@ -0,0 +1,18 @@
+#pragma once
+
+// Small hardware abstraction so that the protocol code can be built on the host (env:native)
+#ifdef ARDUINO
+
+#include <Arduino.h>
+
+#else
+
+#include <stdint.h>
+
+#define IRAM_ATTR
+#define RTC_DATA_ATTR
+
+unsigned long micros();
+unsigned long millis();
+
+#endif
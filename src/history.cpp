@@ -0,0 +1,22 @@
+#include "history.h"
+
+uint32_t addHistory(tHistory *h, time_t time, const tFrame *frame)
+{
+    uint32_t Num = h->Count;
+
+    h->Records[Num % HISTORY_LENGTH] = packReading(time, frame->IdNumber, frame->Pressure, frame->Battery, frame->Corrected);
+    h->Count++;
+
+    return Num;
+}
+
+bool readHistory(const tHistory *h, uint32_t num, tReading *reading)
+{
+    if ((num >= h->Count) || (num < historyOldest(h)))
+        return false;
+
+    unpackReading(h->Records[num % HISTORY_LENGTH], reading);
+    reading->Num = num;
+
+    return true;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+#include "decoder.h"
+
+// History of the readings, kept in RTC memory during deep sleep
+// Each reading is packed in 8 bytes, the strings are only made when the history is exported
+#define HISTORY_LENGTH 800       // 6400 bytes, as much RTC memory as the 100 unpacked readings before
+#define HISTORY_EPOCH 1704067200 // 01/01/2024 - 00:00:00 : time is stored from there, in s
+
+// Bits 0..28  : time since HISTORY_EPOCH - s (17 years)
+// Bit 29      : frame corrected by the decoder - 0 in the records logged before
+// Bits 30..49 : ID (6 digits < 2^20)
+// Bits 50..61 : pressure, half of the PSI
+// Bits 62..63 : battery
+typedef uint64_t tRecord;
+
+typedef struct
+{
+    uint32_t Count; // # of readings added since the first start, the newest is Count - 1
+    uint32_t First; // First reading since the RTC memory was cleared
+    tRecord Records[HISTORY_LENGTH];
+} tHistory;
+
+// Reading unpacked
+typedef struct
+{
+    uint32_t Num;
+    time_t Time;
+    uint32_t Id;
+    int Pressure; // Half of the pressure in PSI
+    tBattery Battery;
+    bool Corrected; // Bits flipped by the decoder : the reading may be wrong
+} tReading;
+
+static inline tRecord packReading(time_t time, uint32_t id, int pressure, tBattery battery, bool corrected)
+{
+    uint64_t Delta = (time > HISTORY_EPOCH) ? (uint64_t)(time - HISTORY_EPOCH) : 0;
+
+    if (Delta > 0x1FFFFFFF)
+        Delta = 0x1FFFFFFF;
+
+    return Delta | ((uint64_t)corrected << 29) | ((uint64_t)(id & 0xFFFFF) << 30) | ((uint64_t)(pressure & 0xFFF) << 50) |
+           ((uint64_t)battery << 62);
+}
+
+static inline void unpackReading(tRecord record, tReading *reading)
+{
+    reading->Time = HISTORY_EPOCH + (time_t)(record & 0x1FFFFFFF);
+    reading->Corrected = (record >> 29) & 1;
+    reading->Id = (record >> 30) & 0xFFFFF;
+    reading->Pressure = (record >> 50) & 0xFFF;
+    reading->Battery = (tBattery)(record >> 62);
+}
+
+// Returns the number of the reading
+uint32_t addHistory(tHistory *h, time_t time, const tFrame *frame);
+
+// After a power loss : numbers continue from the ones already saved in the flash log
+static inline void resumeHistory(tHistory *h, uint32_t num)
+{
+    h->Count = num;
+    h->First = num;
+}
+
+// Oldest reading still in the history - nothing in the history when oldest == Count
+static inline uint32_t historyOldest(const tHistory *h)
+{
+    return (h->Count - h->First > HISTORY_LENGTH) ? h->Count - HISTORY_LENGTH : h->First;
+}
+
+// False if the reading is not in the history (not received yet, or overwritten)
+bool readHistory(const tHistory *h, uint32_t num, tReading *reading);
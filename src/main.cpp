@@ -4,64 +4,62 @@
 #include "web.h"
 #include "display.h"
 #include "MH8A.h"
-
-#define ADC_PIN_BATTERY 10 // GPIO10
+#include "timekeeping.h"
+#include "metrics.h"
+#include "scheduler.h"
+#include "transmitters.h"
+#include "capture.h"
+#include "battery.h"
 
 #define PIN_MOSFET_33V 7 // GPIO 7
 #define PIN_WAKE_UP 0    // GPIO 0
 
 #define TIME_TO_SLEEP 60000  // ms
-#define SLEEP_DURATION_SEC 5 // s
+#define SLEEP_MESSAGE_TIME 5000 // ms - "Sleep ..." displayed before the deep sleep
 
-#define NB_BATTERY_FILTER 5 // # of values for filtering
+#define TASK_REPORT_PERIOD 10000 // ms
 
-bool FirstTime = 1;
+// Periods of the jobs of loop()
+#define BATTERY_PERIOD 500 // ms
+#define BUTTON_PERIOD 20   // ms
+#define WEB_PERIOD 2       // ms
+#define WEB_PRESS_TIME 2000 // ms - longer press : WiFi activated
 
-unsigned long startMillis;
+#define LIGHT_SLEEP_MIN 20 // ms - shorter waits are done awake
 
-// Read battery voltage and filter it on NB_BATTERY_FILTER values
-void ComputeBatteryVoltage()
-{
-  static int startMicros = 0;
-  float Result = -1.0;
-
-  if (micros() - startMicros < 500000)
-  {
-    return;
-  }
+#define POWER_SETTLE 5 // ms - 3.3V of the MOSFET for the receiver, not measured : the screen is probed by initDisplay()
 
-  static int Array[NB_BATTERY_FILTER] = {0}; // Buffer to store the values
-  static int Next = NB_BATTERY_FILTER - 1;   // Position of the next value to write
-  static int Nb = 0;                         // Nb of values already read
-  static int Sum = 0;                        // Sum of values
-  int LastValue = 0;                         // Last value (to be removed from the sum)
-
-  int adcValueReceiver = analogReadMilliVolts(ADC_PIN_BATTERY);
-
-  // Put index on the next slot in the buffer - reset to 0 if end of array
-  Next++;
-  if (Next >= NB_BATTERY_FILTER)
-    Next = 0;
+bool FirstTime = 1;
 
-  // get the value that is currently in this slot as it will be overwritten
-  LastValue = Array[Next];
+// Everything loop() does at a given time
+tScheduler scheduler;
+int sleepJob = -1;
+int webJob = -1;
+bool goingToSleep = false;
+tBatteryMonitor battery;
+unsigned long listenMillis = 0; // Carrier woke the chip up : listening until the new transmitter is known
+unsigned long loopMax = 0; // us - longest iteration of loop() since the last report
+uint32_t reportCycles = 0; // Battery cycles counted at the last report, the counter goes on across deep sleep
+unsigned long reportMillis = 0; // ms
+
+// Wake up and time asleep, kept during deep sleep
+RTC_DATA_ATTR tClockStats clockStats;
+RTC_DATA_ATTR uint32_t savedMetrics[NB_COUNTERS];
+RTC_DATA_ATTR uint32_t bootTimes[NB_BOOT_PHASES];
+
+void bootPhase(tBootPhase phase)
+{
+  bootTimes[phase] = micros();
+}
 
-  // Put the new value & add to the sum
-  Array[Next] = adcValueReceiver;
-  Sum += adcValueReceiver;
+// Samples of the battery taken by the DMA since the last call, the voltage is drawn only when its rounded value changes
+void ComputeBatteryVoltage()
+{
+  float volts;
 
-  // If array still not full, just inc the number of values
-  if (Nb < NB_BATTERY_FILTER)
-    Nb++;
-  else
-  // else, we remove from the sum the saved value and return the filtered voltage
-  {
-    Sum -= LastValue;
-    Result = Sum * 3.0 / NB_BATTERY_FILTER / 1000;
-  }
+  readBatteryAdc(&battery, millis() / 1000);
 
-  // If filetring finished -> display the batterie level
-  if (Result != -1.0)
+  if (batteryDisplay(&battery, &volts))
   {
     if (FirstTime)
     {
@@ -71,10 +69,45 @@ void ComputeBatteryVoltage()
     else
       clearBottomRight();
 
-    displayText(bottomRightMid, 1, "%.2fV", Result);
+    displayText(bottomRightMid, 1, "%.2fV", volts);
   }
+}
 
-  startMicros = micros();
+// Stack left and longest time between 2 iterations of each task, I2C load of the screen
+// Printed every TASK_REPORT_PERIOD
+void ReportTasks()
+{
+  unsigned StackFree, QueueFull;
+  unsigned long DecodeMaxLoop, FlushBytes, FlushMicros;
+  decodeTaskStats(&StackFree, &DecodeMaxLoop, &QueueFull);
+  displayStats(&FlushBytes, &FlushMicros);
+
+  unsigned EventClients;
+  unsigned long EventDelivered, EventDropped, EventLatency;
+  eventStats(&EventClients, &EventDelivered, &EventDropped, &EventLatency);
+
+  uint32_t Now = micros();
+  Trace(traceTasks, Now, {StackFree, (uint32_t)DecodeMaxLoop, QueueFull, (uint32_t)uxTaskGetStackHighWaterMark(NULL), (uint32_t)loopMax});
+  Trace(traceDisplay, Now, {(uint32_t)(FlushBytes * 1000 / TASK_REPORT_PERIOD), (uint32_t)(FlushMicros * 1000 / TASK_REPORT_PERIOD)});
+  Trace(traceClock, Now, {clockStats.Wakes, clockStats.AvoidedWakes, clockEnergySaved(&clockStats),
+                          (uint32_t)(clockStats.Slept / 1000000)});
+  Trace(traceEvents, Now, {EventClients, (uint32_t)EventDelivered, (uint32_t)EventDropped, (uint32_t)EventLatency});
+
+  uint32_t Elapsed = Now - scheduler.StatsStart;
+  Trace(traceScheduler, Now, {scheduler.Runs, (uint32_t)(scheduler.Runs ? scheduler.JitterSum / scheduler.Runs : 0),
+                              scheduler.MaxJitter, (uint32_t)(Elapsed ? scheduler.Idle * 1000ULL / Elapsed : 0)});
+
+  // Cycles spent since the last report only
+  uint32_t runtime = batteryRuntime(&battery);
+  uint32_t cycles = metricCounters[metricBatteryCycles].load();
+  unsigned long window = millis() - reportMillis;
+  Trace(traceBattery, Now, {(uint32_t)(battery.Voltage * 1000 + 0.5f), (uint32_t)(battery.Charge * 100 + 0.5f), runtime / 60,
+                            (uint32_t)(window ? (cycles - reportCycles) * 1000ULL / window : 0)});
+  reportCycles = cycles;
+  reportMillis += window;
+
+  loopMax = 0;
+  resetSchedulerStats(&scheduler, Now);
 }
 
 void activateBoardPower()
@@ -93,63 +126,210 @@ void deactivateBoardPower()
   gpio_deep_sleep_hold_en();
 }
 
-void setup()
+// Jobs of loop() : each one returns the time before its next run
+uint32_t ReportJob(void *)
 {
-  esp_sleep_wakeup_cause_t cause = esp_sleep_get_wakeup_cause();
+  ReportTasks();
+  return TASK_REPORT_PERIOD * 1000;
+}
+
+// Compute battery level of the receiver
+uint32_t BatteryJob(void *)
+{
+  uint32_t cycles = ESP.getCycleCount();
+  ComputeBatteryVoltage();
+  countMetric(metricBatteryCycles, ESP.getCycleCount() - cycles);
+  return BATTERY_PERIOD * 1000;
+}
 
-  if (cause == ESP_SLEEP_WAKEUP_TIMER)
+uint32_t TanksJob(void *)
+{
+  return rotateTanks() * 1000;
+}
+
+uint32_t WebJob(void *)
+{
+  loopWeb();
+  return WEB_PERIOD * 1000;
+}
+
+uint32_t ButtonJob(void *)
+{
+  static unsigned long pressMillis = 0;
+  static bool buttonPressed = false;
+
+  // When button is pressed, raz of wake up timer & update time
+  if (digitalRead(PIN_WAKE_UP) == LOW)
   {
-    // if wakeup by timer, add sleep duration to global timestamp
-    timestamp += SLEEP_DURATION_SEC;
+    if (!buttonPressed)
+      pressMillis = millis();
+    buttonPressed = true;
+
+    razTimerGoToSleep();
+    LiveIndicatorAndTime();
+
+    // Long press : WiFi activated, once
+    if ((webJob < 0) && (millis() - pressMillis > WEB_PRESS_TIME))
+    {
+      initWeb();
+      webJob = addJob(&scheduler, "web", WebJob, NULL, micros(), 0);
 
-    // Immediately go back to deep sleep
-    esp_sleep_enable_ext0_wakeup((gpio_num_t)PIN_WAKE_UP, LOW);
-    esp_sleep_enable_timer_wakeup(SLEEP_DURATION_SEC * 1000000ULL);
-    esp_deep_sleep_start();
+      displayText(bottomLeftMid, 1, "Wifi Activated");
+    }
   }
-  else if (cause == ESP_SLEEP_WAKEUP_EXT0)
+  else
   {
-    // Add half of the sleep duration to the wakeup timer (as it is not possible to measure the time asleep)
-    timestamp += SLEEP_DURATION_SEC / 2;
+    // Short press : pin / unpin the tank displayed
+    if (buttonPressed && (millis() - pressMillis <= WEB_PRESS_TIME))
+      pinTank();
+
+    buttonPressed = false;
+  }
+
+  return BUTTON_PERIOD * 1000;
+}
+
+uint32_t DeepSleepJob(void *)
+{
+  goToSleep();
+  return JOB_DONE;
+}
+
+// Nothing received and no button pressed for TIME_TO_SLEEP : only the web and the report go on
+// until the deep sleep
+uint32_t SleepJob(void *)
+{
+  Trace(traceSleep, micros(), {});
+
+  goingToSleep = true;
+  for (int job = 0; job < scheduler.NbJobs; job++)
+    if ((job != webJob) && (scheduler.Jobs[job].Function != ReportJob))
+      cancelJob(&scheduler, job);
+
+  clearBottom();
+  displayText(bottomLeftHigh, 2, "Sleep ...");
+
+  addJob(&scheduler, "deep sleep", DeepSleepJob, NULL, micros(), SLEEP_MESSAGE_TIME * 1000);
+  return JOB_DONE;
+}
+
+// Jobs which can wait for the end of a light sleep : the button wakes the chip up, the others are not urgent
+void addLazyJob(const char *name, tJobFunction function, uint32_t now, uint32_t delay)
+{
+  int job = addJob(&scheduler, name, function, NULL, now, delay);
+
+  if (job >= 0)
+    scheduler.Jobs[job].Lazy = true;
+}
+
+// Between the frames expected from the transmitters : light sleep until the next one, the next job which
+// cannot wait, the carrier or the button - returns false when the receiver must stay awake
+bool LightSleep()
+{
+  if ((webJob >= 0) || goingToSleep || !receiverIdle() || (digitalRead(PIN_WAKE_UP) == LOW))
+    return false;
+  if (millis() - listenMillis < SYNC_LISTEN)
+    return false;
+
+  uint32_t sleepMs = transmittersSleepTime(millis());
+  uint32_t jobMs = nextStrictJob(&scheduler, micros()) / 1000;
+  if (jobMs < sleepMs)
+    sleepMs = jobMs;
+
+  if ((sleepMs < LIGHT_SLEEP_MIN) || !captureSleep())
+    return false;
+
+  gpio_wakeup_enable((gpio_num_t)PIN_WAKE_UP, GPIO_INTR_LOW_LEVEL);
+  esp_sleep_enable_gpio_wakeup();
+  esp_sleep_enable_timer_wakeup((uint64_t)sleepMs * 1000);
+
+  unsigned long start = micros();
+  esp_light_sleep_start();
+  unsigned long slept = micros() - start;
+
+  if ((esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_GPIO) && (digitalRead(PIN_WAKE_UP) == HIGH))
+    listenMillis = millis();
+
+  esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_TIMER);
+  gpio_wakeup_disable((gpio_num_t)PIN_WAKE_UP);
+  captureWake();
+
+  scheduler.Idle += slept;
+  countMetric(metricLightSleep, slept / 1000);
+  return true;
+}
+
+void setup()
+{
+  esp_sleep_wakeup_cause_t cause = esp_sleep_get_wakeup_cause();
+  bool firstStart = false;
+
+  memset(bootTimes, 0, sizeof(bootTimes));
+  bootPhase(bootSetup);
+
+  // Counters since the first start
+  restoreMetrics(savedMetrics);
+  reportCycles = metricCounters[metricBatteryCycles].load();
+
+  // Time has been kept by the RTC timer during deep sleep
+  if (cause == ESP_SLEEP_WAKEUP_EXT0)
+  {
+    clockWake(&clockStats, clockNowUs());
   }
   else
   {
     // First start
-    timestamp = 1735689600; // 01/01/2025 - 00:00:00
+    initClock();
+    firstStart = true;
   }
 
-  // Serial init
-  Serial.begin(115200);
-  delay(500);
+  // Receiver powered and capture attached first : the frames sent during the rest of the boot
+  // are decoded by the decoding task and wait in its queue for loop()
+  activateBoardPower();
+  delay(POWER_SETTLE);
 
-  // Set attenuation at 11dB to read up to 2V
-  analogReadResolution(8);
-  analogSetAttenuation(ADC_11db);
+  initMH8A();
 
-  activateBoardPower();
+  // Serial init, the messages are dropped until a terminal reads them
+  Serial.begin(115200);
 
-  delay(200);
+  // Battery sampled in the background from now on
+  initBatteryAdc(&battery);
+  bootPhase(bootSerial);
 
   initDisplay();
-  initMH8A();
-
-  // Used to go to sleep
-  startMillis = millis();
+  bootPhase(bootDisplay);
+
+  // RTC memory is only lost when the power is cut
+  if (firstStart)
+    initLog(esp_reset_reason() == ESP_RST_POWERON);
+
+  // Work of loop()
+  uint32_t now = micros();
+  resetSchedulerStats(&scheduler, now);
+  addLazyJob("report", ReportJob, now, TASK_REPORT_PERIOD * 1000);
+  addLazyJob("battery", BatteryJob, now, 0);
+  addLazyJob("button", ButtonJob, now, 0);
+  addLazyJob("tanks", TanksJob, now, 0);
+  sleepJob = addJob(&scheduler, "sleep", SleepJob, NULL, now, TIME_TO_SLEEP * 1000);
+
+  bootPhase(bootReady);
+  Trace(traceBoot, bootTimes[bootSetup], {bootTimes[bootCapture], bootTimes[bootSerial], bootTimes[bootDisplay], bootTimes[bootReady]});
 }
 
 void goToSleep()
 {
+  // Readings still in RTC memory are saved : they would be lost with the power
+  flushLog(true);
+
   deactivateDisplay();
   deactivateBoardPower();
 
-  // Wake up with GPIO
+  // Wake up with GPIO only, the time keeps running during deep sleep
   esp_sleep_enable_ext0_wakeup((gpio_num_t)PIN_WAKE_UP, LOW);
 
-  // Wake up with Timer
-  esp_sleep_enable_timer_wakeup(SLEEP_DURATION_SEC * 1000000ULL);
-
-  // Update timestamp
-  timestamp += micros() / 1000000;
+  clockSleep(&clockStats, clockNowUs());
+  saveMetrics(savedMetrics);
 
   esp_deep_sleep_start();
 }
@@ -163,7 +343,7 @@ void LiveIndicatorAndTime()
 
   static unsigned char index = 0;
 
-  time_t now = timestamp + micros() / 1000000;
+  time_t now = clockNow();
 
   struct tm t;
   localtime_r(&now, &t);
@@ -181,60 +361,40 @@ void LiveIndicatorAndTime()
 
 void razTimerGoToSleep()
 {
-  startMillis = millis();
+  if (!goingToSleep)
+    scheduleJob(&scheduler, sleepJob, micros(), TIME_TO_SLEEP * 1000);
 }
 
 void updateTime(time_t epoch)
 {
-  timestamp = epoch;
+  setClock(epoch);
 }
 
 void loop()
 {
+  unsigned long start = micros();
 
-  static int TimeToActivateWeb = 0;
-
-  loopWeb();
-
-  // Go to sleep after xx secods
-  if (millis() - startMillis < TIME_TO_SLEEP)
-  {
-
-    // When button is pressed, raz of wake up timer & update time
-    if (digitalRead(PIN_WAKE_UP) == LOW)
-    {
-      razTimerGoToSleep();
-      LiveIndicatorAndTime();
+  runJobs(&scheduler, start);
 
-      if (millis() - TimeToActivateWeb > 2000)
-      {
-        initWeb();
-
-        displayText(bottomLeftMid, 1, "Wifi Activated");
-
-        sleep(2);
-      }
-    }
-    else
-    {
-      TimeToActivateWeb = millis();
-    }
-
-    // Compute battery level of the receiver
-    ComputeBatteryVoltage();
-
-    // Read MH8A frames
+  // Display the MH8A frames decoded by the decoding task
+  if (!goingToSleep)
     loopMH8A();
-  }
-  else
-  {
-    Serial.printf("Going to deep sleep\n");
 
-    clearBottom();
-    displayText(bottomLeftHigh, 2, "Sleep ...");
+  // All the updates of this loop are sent at once
+  flushDisplay();
+  frameOnScreen();
 
-    sleep(5);
+  unsigned long busy = micros() - start;
+  if (busy > loopMax)
+    loopMax = busy;
+  observeMetric(histogramLoop, busy);
 
-    goToSleep();
+  // Nothing to do until the next deadline or the next event of the decoding task
+  uint32_t wait = nextJob(&scheduler, micros());
+  if ((wait > 0) && !LightSleep())
+  {
+    unsigned long idle = micros();
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS((wait + 999) / 1000));
+    scheduler.Idle += micros() - idle;
   }
 }
@@ -1,13 +1,34 @@
 #pragma once
 
-typedef struct
+#include <stdint.h>
+#include "scheduler.h"
+#include "battery.h"
+#include "timekeeping.h"
+
+// Jobs of loop()
+extern tScheduler scheduler;
+
+// Battery of the receiver, filtered by the job of loop()
+extern tBatteryMonitor battery;
+
+// Wake up and time asleep, kept during deep sleep
+extern RTC_DATA_ATTR tClockStats clockStats;
+
+// Phases of the boot, time since the start of the application - us
+// The ROM and the bootloader are not counted : micros() starts with the application
+typedef enum
 {
-    int num;
-    tm time;
-    char ID[7];
-    int Pressure;
-    char Battery[9];
-} tHistory;
+    bootSetup = 0, // setup() called
+    bootCapture,   // Capture attached, frames received from now on
+    bootSerial,    // Serial and battery ADC ready
+    bootDisplay,   // Screen ready
+    bootReady,     // End of setup()
+    NB_BOOT_PHASES,
+} tBootPhase;
+
+extern RTC_DATA_ATTR uint32_t bootTimes[NB_BOOT_PHASES];
+
+void bootPhase(tBootPhase phase);
 
 void LiveIndicatorAndTime();
 
@@ -16,5 +37,3 @@ void razTimerGoToSleep();
 void goToSleep();
 
 void updateTime(time_t epoch);
-
-#define HISTORY_LENGTH 100
\ No newline at end of file
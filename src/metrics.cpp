@@ -0,0 +1,119 @@
+#include "metrics.h"
+
+std::atomic<uint32_t> metricCounters[NB_COUNTERS];
+
+typedef struct
+{
+    uint32_t Buckets[HISTOGRAM_BUCKETS + 1]; // Last one : above the last bound
+    uint64_t Sum;                            // us
+    uint32_t Count;
+} tHistogramData;
+
+static tHistogramData Histograms[NB_HISTOGRAMS];
+static const uint32_t Bounds[HISTOGRAM_BUCKETS] = HISTOGRAM_BOUNDS;
+
+typedef struct
+{
+    const char *Name;
+    const char *Help;
+} tMetricInfo;
+
+static const tMetricInfo CounterInfo[NB_COUNTERS] = {
+    {"mh8a_edges_total", "Edges of the carrier seen by the capture"},
+    {"mh8a_symbols_total{bit=\"0\"}", "Pauses classified as 0 or 1"},
+    {"mh8a_symbols_total{bit=\"1\"}", nullptr},
+    {"mh8a_out_of_window_total", "Pauses out of the windows of 0 and 1"},
+    {"mh8a_rejected_total{reason=\"length\"}", "Bursts without any valid frame, by reason"},
+    {"mh8a_rejected_total{reason=\"checksum\"}", nullptr},
+    {"mh8a_rejected_total{reason=\"id\"}", nullptr},
+    {"mh8a_frames_total", "Valid frames"},
+    {"mh8a_corrected_total", "Valid frames after correction of 1 or 2 bits"},
+    {"mh8a_corrections_refused_total", "Corrections refused : unknown ID or pressure too far from the last one"},
+    {"mh8a_events_lost_total", "Events of the decoding task lost because the queue was full"},
+    {"mh8a_log_cycles_total", "CPU cycles spent by loop() to add the messages of the decoding path"},
+    {"mh8a_sync_missed_total", "Frames expected between 2 light sleeps and not received"},
+    {"mh8a_light_sleep_ms_total", "Time in light sleep between the frames"},
+    {"mh8a_battery_cycles_total", "CPU cycles spent by loop() to read and draw the battery"},
+    {"mh8a_web_dropped_total", "Items of a JSON reply or of the metrics longer than the chunk, not sent"},
+};
+
+static const tMetricInfo HistogramInfo[NB_HISTOGRAMS] = {
+    {"mh8a_latency_us", "From the last pause of the frame to the screen"},
+    {"mh8a_loop_us", "Iteration of loop(), without the wait"},
+    {"mh8a_flush_us", "I2C transfer of the screen"},
+    {"mh8a_jitter_us", "From the deadline of a job of loop() to its run"},
+};
+
+void observeMetric(tHistogram histogram, uint32_t us)
+{
+    tHistogramData *h = &Histograms[histogram];
+    int i = 0;
+
+    while ((i < HISTOGRAM_BUCKETS) && (us > Bounds[i]))
+        i++;
+
+    h->Buckets[i]++;
+    h->Sum += us;
+    h->Count++;
+}
+
+void saveMetrics(uint32_t *saved)
+{
+    for (int i = 0; i < NB_COUNTERS; i++)
+        saved[i] = metricCounters[i].load(std::memory_order_relaxed);
+}
+
+void restoreMetrics(const uint32_t *saved)
+{
+    for (int i = 0; i < NB_COUNTERS; i++)
+        metricCounters[i].store(saved[i], std::memory_order_relaxed);
+}
+
+void printMetric(tMetricPrint print, const char *name, const char *type, const char *help)
+{
+    print("# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+void exportMetrics(tMetricPrint print)
+{
+    for (int i = 0; i < NB_COUNTERS; i++)
+    {
+        const tMetricInfo *m = &CounterInfo[i];
+
+        // Name without the labels for the header, only once per family
+        if (m->Help)
+        {
+            char Name[48];
+            int Length = 0;
+
+            while (m->Name[Length] && (m->Name[Length] != '{') && (Length < (int)sizeof(Name) - 1))
+            {
+                Name[Length] = m->Name[Length];
+                Length++;
+            }
+            Name[Length] = 0;
+
+            printMetric(print, Name, "counter", m->Help);
+        }
+
+        print("%s %u\n", m->Name, (unsigned)metricCounters[i].load(std::memory_order_relaxed));
+    }
+
+    for (int i = 0; i < NB_HISTOGRAMS; i++)
+    {
+        const tMetricInfo *m = &HistogramInfo[i];
+        const tHistogramData *h = &Histograms[i];
+        uint32_t Total = 0;
+
+        printMetric(print, m->Name, "histogram", m->Help);
+
+        for (int b = 0; b < HISTOGRAM_BUCKETS; b++)
+        {
+            Total += h->Buckets[b];
+            print("%s_bucket{le=\"%u\"} %u\n", m->Name, (unsigned)Bounds[b], (unsigned)Total);
+        }
+
+        print("%s_bucket{le=\"+Inf\"} %u\n%s_sum %llu\n%s_count %u\n",
+              m->Name, (unsigned)h->Count, m->Name, (unsigned long long)h->Sum, m->Name, (unsigned)h->Count);
+    }
+}
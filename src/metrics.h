@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+// Registry of the metrics, exported at /metrics in the Prometheus text format
+// Fixed memory, no lock : counters can be incremented from the interrupt, the decoding task and loop()
+typedef enum
+{
+    metricEdges = 0,       // Edges of the carrier seen by the capture
+    metricSymbol0,         // Pauses classified as 0
+    metricSymbol1,         // Pauses classified as 1
+    metricOutOfWindow,     // Pauses out of the windows of 0 and 1
+    metricRejectLength,    // Bursts rejected, same order as tReject
+    metricRejectChecksum,
+    metricRejectId,
+    metricFrames,          // Valid frames
+    metricCorrected,       // Valid frames after correction of 1 or 2 bits
+    metricRefused,         // Corrections refused : unknown ID or pressure too far from the last one
+    metricEventsLost,      // Events of the decoding task lost because the queue was full
+    metricLogCycles,       // CPU cycles spent by loop() to add the messages of the decoding path
+    metricSyncMissed,      // Frames expected between 2 light sleeps and not received
+    metricLightSleep,      // Time in light sleep between the frames - ms
+    metricBatteryCycles,   // CPU cycles spent by loop() to read and draw the battery
+    metricWebDropped,      // Items of a web reply longer than the chunk, not sent
+    NB_COUNTERS,
+} tCounter;
+
+typedef enum
+{
+    histogramLatency = 0, // From the last pause of the frame to the screen - us
+    histogramLoop,        // Iteration of loop(), without the wait - us
+    histogramFlush,       // I2C transfer of the screen - us
+    histogramJitter,      // From the deadline of a job of loop() to its run - us
+    NB_HISTOGRAMS,
+} tHistogram;
+
+// Upper bounds of the buckets - us
+#define HISTOGRAM_BUCKETS 12
+#define HISTOGRAM_BOUNDS {50, 100, 200, 500, 1000, 2000, 5000, 10000, 20000, 50000, 100000, 200000}
+
+extern std::atomic<uint32_t> metricCounters[NB_COUNTERS];
+
+// Called from the interrupt too
+static inline __attribute__((always_inline)) void countMetric(tCounter counter, uint32_t n = 1)
+{
+    metricCounters[counter].fetch_add(n, std::memory_order_relaxed);
+}
+
+// Histograms are only observed from loop()
+void observeMetric(tHistogram histogram, uint32_t us);
+
+// Counters are saved in RTC memory before deep sleep and restored at wake up
+void saveMetrics(uint32_t *saved);
+void restoreMetrics(const uint32_t *saved);
+
+// Prometheus text format, printed piece by piece
+// Counters with a label (frames per ID, ...) and gauges are printed by the caller with printMetric()
+typedef void (*tMetricPrint)(const char *format, ...);
+void exportMetrics(tMetricPrint print);
+void printMetric(tMetricPrint print, const char *name, const char *type, const char *help);
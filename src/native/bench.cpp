@@ -0,0 +1,1838 @@
+// Benchmark of the decoding path on the host
+//   pio run -e native -t exec
+//   .pio/build/native/program <file>  : also replay a recorded stream
+// Each scenario checks its own bounds, the program exits with 1 when one of them is not met
+// A recorded stream is either a text file with the duration of each pause in us, one per line,
+// or a raw capture downloaded from tankreader.local/capture.bin
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <math.h>
+#include <new>
+#include <chrono>
+#include <algorithm>
+#include <random>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "hal.h"
+#include "decoder.h"
+#include "ringbuffer.h"
+#include "capture.h"
+#include "transmitters.h"
+#include "events.h"
+#include "history.h"
+#include "flashlog.h"
+#include "consumption.h"
+#include "timekeeping.h"
+#include "metrics.h"
+#include "goertzel.h"
+#include "trace.h"
+#include "scheduler.h"
+#include "battery.h"
+#include "legacy_decoder.h"
+
+#define CARRIER_PERIOD 26   // us - 38kHz
+#define BURST_DURATION 1000 // us
+#define FRAME_GAP 30000     // us - pause between 2 frames
+
+#define NB_FRAMES 2000
+
+// Bounds not met by the scenarios
+static int Failures = 0;
+
+static bool check(bool ok, const char *name, const char *what)
+{
+    if (!ok)
+    {
+        printf("FAILED %s : %s\n", name, what);
+        Failures++;
+    }
+    return ok;
+}
+
+// Every allocation done by the decoding path is counted
+static unsigned long Allocations = 0;
+
+__attribute__((noinline)) void *operator new(size_t size)
+{
+    Allocations++;
+    void *p = malloc(size);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+__attribute__((noinline)) void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+__attribute__((noinline)) void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+
+typedef struct
+{
+    const char *Name;
+    std::vector<uint32_t> Edges;   // Time of each rising edge - us
+    std::vector<uint16_t> Pauses;  // Duration of each pause, as given by the RMT - us
+    int Frames;                  // # of frames in the stream
+} tStream;
+
+// Statistics of the decoders on a stream, checked by main()
+typedef struct
+{
+    tDecoderStats Stream;   // Interrupt, sliding window with the adaptive windows
+    tDecoderStats Gap;      // Interrupt, whole burst with the fixed windows
+    tDecoderStats Fixed;    // Replay of the durations, fixed windows
+    tDecoderStats Adaptive; // Replay of the durations, adaptive windows
+} tRunResults;
+
+// Same processing as the interrupt and the main loop of the receiver
+typedef struct
+{
+    tPulseBuffer Pulses;
+    tStreamDecoder Decoder;
+    long LastTime;
+} tReceiver;
+
+// Add a burst of carrier followed by a pause
+static void addSymbol(tStream *stream, uint32_t *time, uint32_t pause)
+{
+    for (uint32_t t = 0; t < BURST_DURATION; t += CARRIER_PERIOD)
+        stream->Edges.push_back(*time + t);
+
+    stream->Pauses.push_back(edgeToPulse(pause));
+
+    *time += BURST_DURATION - BURST_DURATION % CARRIER_PERIOD + pause;
+}
+
+// Build a valid frame for an ID of 6 digits, a pressure in PSI and a battery 0..2
+static uint64_t tankFrame(uint32_t id, int pressure, int battery)
+{
+    static const uint8_t DigitToNibble[10] = {0xA, 0xB, 0xC, 0x3, 0xD, 0x5, 0x6, 0x7, 0xE, 0x9};
+    static const uint8_t BatteryCode[3] = {0x0, 0x2, 0x1};
+
+    uint64_t Bits = 0x1;         // Preamble
+    Bits = (Bits << 4) | 0x5;    // Sync1
+    Bits = (Bits << 4) | 0xA;    // Sync2
+    for (uint32_t Div = 100000; Div > 0; Div /= 10)
+        Bits = (Bits << 4) | DigitToNibble[id / Div % 10];
+    Bits = (Bits << 12) | pressure;
+    Bits = (Bits << 4) | BatteryCode[battery];
+
+    int Checksum = 0;
+    for (int i = 0; i < 12; i++)
+        Checksum += (Bits >> (44 - i * 4)) & 0xF;
+
+    return (Bits << 8) | (Checksum & 0xFF);
+}
+
+// Build a valid frame for a random ID / pressure / battery
+static uint64_t randomFrame(std::mt19937 &rng)
+{
+    uint32_t Id = 0;
+
+    for (int i = 0; i < 6; i++)
+        Id = Id * 10 + rng() % 10;
+    int Pressure = rng() % 2048;
+
+    return tankFrame(Id, Pressure, rng() % 3);
+}
+
+// Frames of 4 transmitters in turn, pressure slowly decreasing, with jitter on each pause, pauses longer by drift %
+// When noisy : spurious edges inside the pauses, spurious bit before some frames
+// and pauses just inside the window of the other bit
+static void syntheticStream(tStream *stream, const char *name, bool noisy, int drift)
+{
+    static const uint32_t Ids[4] = {123456, 654321, 100200, 987654};
+    std::mt19937 rng(1234);
+    uint32_t Time = 0;
+
+    stream->Name = name;
+    stream->Frames = NB_FRAMES;
+
+    for (int f = 0; f < NB_FRAMES; f++)
+    {
+        uint64_t Bits = tankFrame(Ids[f % 4], 2000 - f / 4, f % 4 % 3);
+
+        if (noisy && (rng() % 10 == 0))
+            addSymbol(stream, &Time, 1000);
+
+        for (int i = FRAME_LENGTH - 1; i >= 0; i--)
+        {
+            uint32_t Pause = ((Bits >> i) & 1) ? 2000 : 1000;
+            Pause = Pause * (100 + drift) / 100 + (int)(rng() % 161) - 80;
+
+            if (noisy && (rng() % 300 == 0))
+                Pause = ((Bits >> i) & 1) ? TIME_MAX_0 - 40 : TIME_MIN_1 + 40;
+
+            if (noisy && (rng() % 200 == 0))
+            {
+                addSymbol(stream, &Time, Pause / 2);
+                stream->Edges.push_back(Time);
+                stream->Pauses.push_back(edgeToPulse(Pause / 2));
+                Time += Pause / 2;
+                continue;
+            }
+
+            addSymbol(stream, &Time, Pause);
+        }
+
+        // Last burst of the frame
+        addSymbol(stream, &Time, FRAME_GAP);
+    }
+}
+
+// One pause per line, a pause longer than TIME_END_FRAME ends a frame
+// Edges of a raw capture : pauses computed as by the interrupt
+static void edgesStream(tStream *stream, const uint32_t *edges, size_t nb)
+{
+    stream->Frames = 0;
+
+    for (size_t i = 0; i < nb; i++)
+    {
+        stream->Edges.push_back(edges[i]);
+
+        uint16_t Pulse = (i > 0) ? edgeToPulse(edges[i] - edges[i - 1]) : 0;
+        if (Pulse)
+            stream->Pauses.push_back(Pulse);
+        if (Pulse > TIME_END_FRAME)
+            stream->Frames++;
+    }
+}
+
+static bool recordedStream(tStream *stream, const char *file)
+{
+    FILE *f = fopen(file, "r");
+    if (!f)
+        return false;
+
+    // Raw capture
+    std::vector<uint8_t> Data;
+    int c;
+    while ((c = fgetc(f)) != EOF)
+        Data.push_back(c);
+
+    size_t Count = rawCaptureCount(Data.data(), Data.size());
+    if (Count > 0)
+    {
+        std::vector<uint32_t> Edges(Count);
+
+        fclose(f);
+        stream->Name = file;
+        if (decodeRawCapture(Data.data(), Data.size(), Edges.data(), Count) != Count)
+            return false;
+
+        edgesStream(stream, Edges.data(), Count);
+        return true;
+    }
+
+    rewind(f);
+
+    uint32_t Time = 0;
+    unsigned long Pause;
+
+    stream->Name = file;
+    stream->Frames = 0;
+
+    while (fscanf(f, "%lu", &Pause) == 1)
+    {
+        addSymbol(stream, &Time, Pause);
+        if (Pause > TIME_END_FRAME)
+            stream->Frames++;
+    }
+
+    fclose(f);
+
+    return true;
+}
+
+static const char *ModeText[] = {"fixed", "adaptive"};
+
+static void readPulses(tReceiver *r)
+{
+    uint16_t Delta;
+    tFrame Frame;
+
+    while (popPulse(&r->Pulses, &Delta))
+        streamPulse(&r->Decoder, Delta, &Frame);
+}
+
+static void endOfFrame(tReceiver *r)
+{
+    tReject Reason;
+    tFrame Frame;
+
+    readPulses(r);
+
+    if (r->Decoder.Burst.Length > 0)
+    {
+        if (!streamRetime(&r->Decoder, &Frame))
+            streamCorrect(&r->Decoder, &Frame);
+        streamEndOfFrame(&r->Decoder, &Reason);
+    }
+}
+
+static void printStats(const char *name, const tDecoderStats *stats)
+{
+    printf("%20s %6u ok %6u resync %6u recovered %6u retimed %6u corrected %6u refused %6u length %6u checksum %6u ID\n",
+           name, stats->Accepted, stats->Resync, stats->Recovered, stats->Retimed, stats->Corrected, stats->Refused,
+           stats->Rejected[rejectLength], stats->Rejected[rejectChecksum], stats->Rejected[rejectId]);
+}
+
+static void printRun(const tStream *stream, const char *name, double ns, size_t nb, const char *unit, unsigned long allocations)
+{
+    int Frames = stream->Frames;
+
+    printf("%20s %12.0f frames/s %10.1f ns/frame %8.2f ns/%s %6.2f alloc/frame\n",
+           name, Frames * 1e9 / ns, ns / Frames, ns / nb, unit, (double)allocations / Frames);
+}
+
+// Interrupt on each edge of the carrier (CAPTURE_GPIO)
+static void run(const tStream *stream, tRunResults *results)
+{
+    tReceiver *r = new tReceiver();
+    size_t Nb = stream->Edges.size();
+
+    r->Decoder.Mode = decoderAdaptive;
+
+    unsigned long AllocationsStart = Allocations;
+    auto Start = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < Nb; i++)
+    {
+        long Time = stream->Edges[i];
+
+        // Main loop : silence long enough -> end of frame
+        if (Time - r->LastTime > TIME_END_FRAME)
+            endOfFrame(r);
+
+        // Interrupt
+        uint16_t Pulse = edgeToPulse(Time - r->LastTime);
+        r->LastTime = Time;
+        if (Pulse)
+            pushPulse(&r->Pulses, Pulse);
+
+        // Main loop : read the pulses from time to time
+        if ((i & 63) == 0)
+            readPulses(r);
+    }
+    endOfFrame(r);
+
+    double Ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - Start).count();
+    unsigned long NbAllocations = Allocations - AllocationsStart;
+
+    printf("%-20s %8d frames %8zu edges %6u overflow %8.0fx real time\n",
+           stream->Name, stream->Frames, Nb, (unsigned)r->Pulses.Overflow.load(),
+           (stream->Edges.back() - stream->Edges.front()) * 1e3 / Ns);
+    printStats("adaptive stream", &r->Decoder.Stream);
+    printStats("fixed gap", &r->Decoder.Gap);
+    printRun(stream, "gpio", Ns, Nb, "edge", NbAllocations);
+
+    results->Stream = r->Decoder.Stream;
+    results->Gap = r->Decoder.Gap;
+    delete r;
+}
+
+// Durations delivered by batch through the capture interface (CAPTURE_RMT)
+static void runReplay(const tStream *stream, tDecoderMode mode, tDecoderStats *stats)
+{
+    tStreamDecoder *Decoder = new tStreamDecoder();
+    char Name[32];
+    size_t Nb = stream->Pauses.size();
+    uint16_t Delta;
+    tFrame Frame;
+    tReject Reason;
+
+    Decoder->Mode = mode;
+    replayCapture(stream->Pauses.data(), Nb);
+
+    unsigned long AllocationsStart = Allocations;
+    auto Start = std::chrono::steady_clock::now();
+
+    while (readPulse(&Delta))
+    {
+        streamPulse(Decoder, Delta, &Frame);
+
+        // A pause longer than the end of frame is the idle between 2 batches
+        if ((Delta > TIME_END_FRAME) && (Decoder->Burst.Length > 0))
+        {
+            if (!streamRetime(Decoder, &Frame))
+                streamCorrect(Decoder, &Frame);
+            streamEndOfFrame(Decoder, &Reason);
+        }
+    }
+
+    double Ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - Start).count();
+
+    snprintf(Name, sizeof(Name), "replay %s", ModeText[mode]);
+    printStats(Name, &Decoder->Stream);
+    printRun(stream, "replay", Ns, Nb, "pause", Allocations - AllocationsStart);
+
+    *stats = Decoder->Stream;
+    delete Decoder;
+}
+
+// Interrupt and decoding task on 2 threads : sequence numbers pushed at the rate of the carrier edges, then
+// as fast as possible. Every value popped must be the next one pushed, none lost when the consumer keeps up
+#define RING_BENCH_PACED 200000   // Pushes at the carrier rate
+#define RING_BENCH_BURST 5000000  // Pushes without any wait
+#define RING_BENCH_PERIOD 26      // us - 38 kHz
+
+static void runRingStress()
+{
+    static tPulseBuffer Ring;
+    std::atomic<bool> Done(false);
+    uint32_t Pushed = 0, Popped = 0, Errors = 0, PacedOverflow = 0;
+
+    std::thread Consumer([&]() {
+        uint16_t Delta;
+
+        while (true)
+        {
+            if (popPulse(&Ring, &Delta))
+            {
+                if (Delta != (uint16_t)Popped)
+                    Errors++;
+                Popped++;
+            }
+            else if (Done.load(std::memory_order_acquire))
+            {
+                // Last values pushed before Done
+                if (!popPulse(&Ring, &Delta))
+                    break;
+                if (Delta != (uint16_t)Popped)
+                    Errors++;
+                Popped++;
+            }
+            else
+                std::this_thread::yield();
+        }
+    });
+
+    auto Start = std::chrono::steady_clock::now();
+    auto Next = Start;
+    for (int n = 0; n < RING_BENCH_PACED; n++)
+    {
+        Next += std::chrono::microseconds(RING_BENCH_PERIOD);
+        while (std::chrono::steady_clock::now() < Next)
+            std::this_thread::yield();
+
+        // A value is only counted once pushed : the sequence popped must have no gap, even with overflows
+        if (pushPulse(&Ring, (uint16_t)Pushed))
+            Pushed++;
+    }
+    PacedOverflow = Ring.Overflow.load();
+    double Rate = RING_BENCH_PACED / std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+
+    for (int n = 0; n < RING_BENCH_BURST; n++)
+        if (pushPulse(&Ring, (uint16_t)Pushed))
+            Pushed++;
+
+    Done.store(true, std::memory_order_release);
+    Consumer.join();
+
+    printf("%-20s %8.0f pushes/s paced %8u popped %6u overflow paced %8u overflow burst %6u out of order\n",
+           "ring stress", Rate, Popped, PacedOverflow, (unsigned)Ring.Overflow.load() - PacedOverflow, Errors);
+
+    check(Rate >= 38000, "ring stress", "producer slower than the carrier");
+    check(Errors == 0, "ring stress", "values lost or torn");
+    check(Popped == Pushed, "ring stress", "values pushed and never popped");
+    check(Pushed + Ring.Overflow.load() == RING_BENCH_PACED + RING_BENCH_BURST, "ring stress", "pushes not counted");
+    // With a single CPU the consumer only runs when the host schedules it : overflows are possible, not gaps
+    check((PacedOverflow == 0) || (std::thread::hardware_concurrency() < 2), "ring stress", "overflow at the carrier rate");
+}
+
+// Cost of decodeFrame() alone
+static void runDecode()
+{
+    std::mt19937 rng(42);
+    std::vector<uint64_t> Frames(100000);
+    tFrame Frame;
+    long Sum = 0;
+
+    for (auto &f : Frames)
+        f = randomFrame(rng);
+
+    unsigned long AllocationsStart = Allocations;
+    auto Start = std::chrono::steady_clock::now();
+
+    for (int n = 0; n < 10; n++)
+        for (auto f : Frames)
+        {
+            decodeFrame(f, FRAME_LENGTH, &Frame);
+            Sum += Frame.Pressure;
+        }
+
+    double Ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - Start).count();
+    size_t Nb = Frames.size() * 10;
+
+    printf("%-20s %12.0f frames/s %10.1f ns/frame %6.2f alloc/frame (%ld)\n",
+           "decodeFrame", Nb * 1e9 / Ns, Ns / Nb, (double)(Allocations - AllocationsStart) / Nb, Sum);
+}
+
+// decodeFrame() against the String decoder of the first version : random bits, a third of them with
+// a valid checksum, and a few lengths around 58
+#define LEGACY_BENCH_FRAMES 2000000
+
+static void runLegacy()
+{
+    std::mt19937 rng(2);
+    tFrame Frame;
+    tLegacyFrame Legacy;
+    int Errors = 0;
+    double Ns = 0, LegacyNs = 0;
+
+    for (int n = 0; n < LEGACY_BENCH_FRAMES; n++)
+    {
+        uint64_t Bits = (n % 3 == 0) ? randomFrame(rng) : (((uint64_t)rng() << 32) | rng()) & ((1ULL << FRAME_LENGTH) - 1);
+        int Length = (n % 1000 == 1) ? FRAME_LENGTH - 1 + rng() % 3 : FRAME_LENGTH;
+        std::string Text;
+
+        for (int i = Length - 1; i >= 0; i--)
+            Text += ((Bits >> i) & 1) ? '1' : '0';
+
+        auto Start = std::chrono::steady_clock::now();
+        bool Decoded = decodeFrame(Bits, Length, &Frame);
+        auto Middle = std::chrono::steady_clock::now();
+        bool LegacyDecoded = legacyDecode(Text, &Legacy);
+        auto End = std::chrono::steady_clock::now();
+
+        Ns += std::chrono::duration<double, std::nano>(Middle - Start).count();
+        LegacyNs += std::chrono::duration<double, std::nano>(End - Middle).count();
+
+        if (Decoded != LegacyDecoded)
+            Errors++;
+        else if (Decoded && ((Legacy.ID != Frame.ID) || (Legacy.Pressure != Frame.Pressure) ||
+                             (Legacy.Battery != batteryText(Frame.Battery)) || (Legacy.ChecksumCalc != Frame.ChecksumCalc) ||
+                             (Legacy.ChecksumMsg != Frame.ChecksumMsg) ||
+                             ((Legacy.ChecksumCalc == Legacy.ChecksumMsg) != Frame.ChecksumOk)))
+            Errors++;
+    }
+
+    printf("%-20s %d frames %8.1f ns/frame (%.1f ns/frame before) %d different\n",
+           "decodeFrame legacy", LEGACY_BENCH_FRAMES, Ns / LEGACY_BENCH_FRAMES, LegacyNs / LEGACY_BENCH_FRAMES, Errors);
+    check(Errors == 0, "decodeFrame legacy", "result different from the first decoder");
+}
+
+// Frames with a valid checksum and a digit of the ID without code, some followed by a spurious bit :
+// never emitted, every burst rejected for its ID
+static void runUnknownId()
+{
+    std::mt19937 rng(4);
+    tStreamDecoder *Decoder = new tStreamDecoder();
+    tFrame Frame;
+    tReject Reason;
+    const int Nb = 1000;
+    int Emitted = 0;
+
+    for (int n = 0; n < Nb; n++)
+    {
+        // First digit of the ID replaced by 0x0, checksum computed again
+        uint64_t Bits = (randomFrame(rng) >> 8) & ~(0xFULL << 36);
+        int Checksum = 0;
+        for (int i = 0; i < 12; i++)
+            Checksum += (Bits >> (44 - i * 4)) & 0xF;
+        Bits = (Bits << 8) | (Checksum & 0xFF);
+
+        for (int i = FRAME_LENGTH - 1; i >= 0; i--)
+            Emitted += streamPulse(Decoder, ((Bits >> i) & 1) ? 2000 : 1000, &Frame);
+        if (n & 1)
+            Emitted += streamPulse(Decoder, 1000, &Frame);
+        Emitted += streamEndOfFrame(Decoder, &Reason);
+    }
+
+    printf("%-20s %d frames %d emitted %u rejected for the ID\n", "unknown ID digit", Nb, Emitted,
+           Decoder->Stream.Rejected[rejectId]);
+    check((Emitted == 0) && (Decoder->Stream.Rejected[rejectId] == (uint32_t)Nb), "unknown ID digit",
+          "frame emitted or not rejected for its ID");
+
+    delete Decoder;
+}
+
+// 2 transmitters heard in turn, one slower and one faster than the fixed windows : the shared windows
+// follow the last one heard, the windows of each transmitter decode the bursts the shared ones miss
+// once a first frame of the transmitter has been decoded - returns the # of frames decoded
+static int runTwoDrifts(bool retime)
+{
+    std::mt19937 rng(11);
+    tStreamDecoder *Decoder = new tStreamDecoder();
+    const uint32_t Ids[2] = {123456, 654321};
+    const int Drifts[2] = {18, -8};
+    tFrame Frame;
+    tReject Reason;
+    int Emitted = 0, Wrong = 0, Missed = 0;
+
+    Decoder->Mode = decoderAdaptive;
+
+    for (int f = 0; f < NB_FRAMES; f++)
+    {
+        int Tank = f & 1;
+        uint64_t Bits = tankFrame(Ids[Tank], 1500 + f / 100, 0);
+
+        for (int i = FRAME_LENGTH - 1; i >= 0; i--)
+        {
+            uint32_t Pause = ((Bits >> i) & 1) ? 2000 : 1000;
+            Pause = Pause * (100 + Drifts[Tank]) / 100 + (int)(rng() % 161) - 80;
+
+            if (streamPulse(Decoder, Pause, &Frame))
+                Emitted++, Wrong += (Frame.IdNumber != Ids[Tank]);
+        }
+        if (retime && streamRetime(Decoder, &Frame))
+            Emitted++, Wrong += (Frame.IdNumber != Ids[Tank]);
+
+        // After the first quarter, both transmitters have been heard at least once
+        if (!Decoder->Emitted && (f >= NB_FRAMES / 4))
+            Missed++;
+        streamEndOfFrame(Decoder, &Reason);
+    }
+
+    const char *Name = retime ? "2 drifts per ID" : "2 drifts shared";
+    printStats(Name, &Decoder->Stream);
+    check(Wrong == 0, Name, "frame emitted for the other transmitter");
+    if (retime)
+        check(Missed == 0, Name, "frame of a known transmitter not decoded");
+
+    delete Decoder;
+
+    return Emitted;
+}
+
+// Cost of streamCorrect() on windows of 58 random bits, all of them unreliable but the checksum : most windows
+// cannot be corrected so that all the candidates are tried, none may be accepted as they come from no known
+// transmitter. Then frames of known transmitters with 1 or 2 unreliable bits flipped, checksum included :
+// a correction must give back the frame sent, but for the 2 flips matched by chance by other bits : these are
+// shown as corrected, all the corrected frames must be marked
+#define CORRECTION_WRONG 2 // Per 1000 corrections
+static void runCorrect()
+{
+    std::mt19937 rng(7);
+    tStreamDecoder *Decoder = new tStreamDecoder();
+    const uint32_t Ids[4] = {123456, 654321, 100200, 987654};
+    int Pressures[4] = {1500, 1200, 900, 2000};
+    tFrame Frame;
+    tReject Reason;
+    const int Nb = 100000;
+    std::vector<double> Times(Nb);
+    double Total = 0;
+    int Corrected = 0;
+
+    // Transmitters known by the decoder
+    for (int t = 0; t < 4; t++)
+    {
+        uint64_t Bits = tankFrame(Ids[t], Pressures[t], 0);
+
+        for (int i = FRAME_LENGTH - 1; i >= 0; i--)
+            streamPulse(Decoder, ((Bits >> i) & 1) ? 2000 : 1000, &Frame);
+        streamEndOfFrame(Decoder, &Reason);
+    }
+
+    for (int n = 0; n < Nb; n++)
+    {
+        Decoder->Emitted = false;
+        Decoder->Window.Bits = (((uint64_t)rng() << 32) | rng()) & ((1ULL << FRAME_LENGTH) - 1);
+        Decoder->Window.Length = FRAME_LENGTH;
+        for (int i = 0; i < FRAME_LENGTH; i++)
+            Decoder->Confidence[i] = (i < CORRECTION_LAST_BIT) ? rng() % CORRECTION_CONFIDENCE : CORRECTION_CONFIDENCE;
+
+        auto Start = std::chrono::steady_clock::now();
+        Corrected += streamCorrect(Decoder, &Frame);
+        double Ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - Start).count();
+
+        Times[n] = Ns;
+        Total += Ns;
+    }
+
+    std::sort(Times.begin(), Times.end());
+
+    printf("%-20s %10.1f ns/window %10.1f ns p99.9 %6d false corrections / %d %u refused\n",
+           "streamCorrect", Total / Nb, Times[Nb - Nb / 1000], Corrected, Nb, Decoder->Stream.Refused);
+    check(Corrected == 0, "streamCorrect", "random window corrected");
+
+    int Fixed = 0, Wrong = 0, Checksum = 0, Correctable = 0, Unmarked = 0;
+
+    for (int n = 0; n < Nb; n++)
+    {
+        int t = n % 4;
+        int Pressure = Pressures[t] + (int)(rng() % (2 * CORRECTION_MAX_STEP + 1)) - CORRECTION_MAX_STEP;
+        uint64_t Bits = tankFrame(Ids[t], Pressure, 0);
+        uint64_t Sent = Bits;
+
+        // The flipped bits are the least reliable ones, among a few other unreliable bits out of the checksum
+        for (int i = 0; i < FRAME_LENGTH; i++)
+            Decoder->Confidence[i] = CORRECTION_CONFIDENCE + 50;
+        for (int i = 0; i < 4; i++)
+            Decoder->Confidence[rng() % CORRECTION_LAST_BIT] = 20 + rng() % (CORRECTION_CONFIDENCE - 20);
+
+        bool InChecksum = false;
+        for (int Flips = 1 + n % 2; Flips > 0; Flips--)
+        {
+            int Pos = rng() % FRAME_LENGTH;
+
+            Bits ^= 1ULL << (FRAME_LENGTH - 1 - Pos);
+            Decoder->Confidence[Pos] = rng() % 20;
+            InChecksum |= (Pos >= CORRECTION_LAST_BIT);
+        }
+
+        Decoder->Emitted = false;
+        Decoder->Window.Bits = Bits;
+        Decoder->Window.Length = FRAME_LENGTH;
+        Correctable += (Bits != Sent) && !InChecksum;
+        if ((Bits == Sent) || !streamCorrect(Decoder, &Frame))
+            continue;
+        Unmarked += !Frame.Corrected;
+
+        // The frame decoded from the bits sent
+        tFrame Expected;
+        decodeFrame(Sent, FRAME_LENGTH, &Expected);
+        Unmarked += Expected.Corrected;
+        if ((Frame.IdNumber != Expected.IdNumber) || (Frame.Pressure != Expected.Pressure) ||
+            (Frame.Battery != Expected.Battery))
+            Wrong++;
+        else
+            Fixed++;
+        Checksum += InChecksum;
+    }
+
+    printf("%-20s %6d corrected %6d wrong %6d with the checksum changed / %d frames correctable\n",
+           "streamCorrect known", Fixed, Wrong, Checksum, Correctable);
+    check(Wrong * 1000 <= (Fixed + Wrong) * CORRECTION_WRONG, "streamCorrect known", "too many frames corrected into another one");
+    check(Checksum == 0, "streamCorrect known", "frame corrected with a bit of the checksum flipped");
+    check(Unmarked == 0, "streamCorrect known", "corrected frame not marked, or decoded frame marked");
+    check(Fixed >= Correctable * 60 / 100, "streamCorrect known", "less than 60 % of the frames corrected");
+
+    delete Decoder;
+}
+
+// Frames received from nb transmitters in turn, more than MAX_TRANSMITTERS forces evictions
+static void runTransmitters(int nb)
+{
+    std::mt19937 rng(99);
+    std::vector<tFrame> Frames(nb);
+    const int Nb = 1000000;
+    uint32_t Found = 0;
+
+    for (auto &f : Frames)
+    {
+        f.IdNumber = rng() % 1000000;
+        f.Pressure = rng() % 2048;
+        f.Battery = batteryGood;
+    }
+
+    unsigned long AllocationsStart = Allocations;
+    auto Start = std::chrono::steady_clock::now();
+
+    for (int n = 0; n < Nb; n++)
+    {
+        const tFrame *f = &Frames[rng() % nb];
+
+        updateTransmitter(f, n);
+        Found += (findTransmitter(f->IdNumber) != nullptr);
+    }
+
+    double Ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - Start).count();
+
+    printf("%-20s %4d IDs %8.1f ns/frame %6.2f alloc/frame %4d in table\n",
+           "transmitters", nb, Ns / Nb, (double)(Allocations - AllocationsStart) / Nb, nbTransmitters());
+    check(Found == (uint32_t)Nb, "transmitters", "transmitter not found just after its frame");
+    check(nbTransmitters() == std::min(nb, MAX_TRANSMITTERS), "transmitters", "table not filled up to its size");
+    check(Allocations == AllocationsStart, "transmitters", "allocation in the table");
+
+    // Empty the table for the next run
+    evictStaleTransmitters(Nb + TRANSMITTER_STALE_TIME + 1);
+}
+
+// A tank pinned on the screen stops sending : the rotation must start again once it is stale, or once it
+// has been evicted to make room for new transmitters
+static void runPinnedTank()
+{
+    std::vector<tFrame> Frames(MAX_TRANSMITTERS + 1);
+    uint32_t Now = 1;
+    bool Pinned = true;
+    int Kept = 0;
+
+    for (size_t i = 0; i < Frames.size(); i++)
+    {
+        Frames[i].IdNumber = 200000 + i;
+        Frames[i].Pressure = 1500;
+        Frames[i].Battery = batteryGood;
+    }
+
+    // Frames[0] pinned, Frames[1] and [2] still sending
+    for (int i = 0; i < 3; i++)
+        updateTransmitter(&Frames[i], Now);
+    for (; Now < TRANSMITTER_STALE_TIME * 2; Now += 5000)
+    {
+        updateTransmitter(&Frames[1], Now);
+        updateTransmitter(&Frames[2], Now);
+        evictStaleTransmitters(Now);
+        if (nextTank(Frames[0].IdNumber, &Pinned) < 0)
+            Kept++;
+        else
+            break;
+    }
+
+    printf("%-20s pin kept %d times, released after %u s\n", "pinned tank", Kept, (unsigned)(Now - 1) / 1000);
+    check(!Pinned && (Now > TRANSMITTER_STALE_TIME), "pinned tank", "pin not released when the tank is stale");
+    check(Now <= TRANSMITTER_STALE_TIME + 5000 + 1, "pinned tank", "pin released late");
+
+    // Pinned again, then evicted by a full table
+    updateTransmitter(&Frames[0], Now);
+    Pinned = true;
+    for (size_t i = 1; i < Frames.size(); i++)
+        updateTransmitter(&Frames[i], ++Now);
+    check(findTransmitter(Frames[0].IdNumber) == nullptr, "pinned tank", "oldest tank not evicted");
+    check((nextTank(Frames[0].IdNumber, &Pinned) >= 0) && !Pinned, "pinned tank", "pin not released when the tank is evicted");
+
+    evictStaleTransmitters(Now + TRANSMITTER_STALE_TIME + 1);
+}
+
+// Frames of transmitters sent on their own period, received only when the receiver listens at their start
+// The receiver sleeps as long as transmittersSleepTime() allows it, the start of a frame wakes it up (GPIO)
+// but this frame is lost
+#define SYNC_BENCH_TIME 3600000 // ms
+#define SYNC_BENCH_STEP 10      // ms - loop() when awake
+#define SYNC_BENCH_DECODE 170   // ms - from the start of a frame to its decoding
+#define SYNC_BENCH_MIN_SLEEP 20 // ms
+
+typedef struct
+{
+    const char *Name;
+    int Nb;
+    uint32_t Period[3]; // ms
+    uint32_t Join[3];   // ms
+    int Jitter;         // ms, +/-
+    float Lost;         // Frames not sent (out of range)
+    float MaxAwake;     // % - bound of the time awake
+    float MaxLost;      // % - bound of the frames lost by the sleep
+} tSyncScenario;
+
+typedef struct
+{
+    uint32_t Start; // ms
+    int Tank;
+} tBenchFrame;
+
+static void runSync(const tSyncScenario *sc)
+{
+    std::mt19937 rng(5);
+    std::vector<tBenchFrame> Frames;
+
+    for (int i = 0; i < sc->Nb; i++)
+        for (uint32_t t = sc->Join[i] + rng() % sc->Period[i]; t < SYNC_BENCH_TIME; t += sc->Period[i])
+            if ((rng() % 10000) >= sc->Lost * 10000)
+                Frames.push_back({t + (int)(rng() % (2 * sc->Jitter + 1)) - sc->Jitter, i});
+    std::sort(Frames.begin(), Frames.end(), [](const tBenchFrame &a, const tBenchFrame &b) { return a.Start < b.Start; });
+
+    tFrame Tanks[3];
+    for (int i = 0; i < 3; i++)
+    {
+        Tanks[i] = tFrame();
+        Tanks[i].IdNumber = 100000 + i;
+        Tanks[i].Pressure = 1500;
+        Tanks[i].Battery = batteryGood;
+    }
+
+    uint32_t Time = 1, Awake = 0, LostBySleep = 0, Received = 0, ListenUntil = 0;
+    size_t Next = 0;
+    std::vector<tBenchFrame> Pending;
+    uint32_t MissedStart = metricCounters[metricSyncMissed].load();
+
+    while (Time < SYNC_BENCH_TIME)
+    {
+        // Listening : frames starting now are received
+        while ((Next < Frames.size()) && (Frames[Next].Start <= Time))
+            Pending.push_back(Frames[Next++]);
+
+        for (size_t i = 0; i < Pending.size();)
+            if (Pending[i].Start + SYNC_BENCH_DECODE <= Time)
+            {
+                updateTransmitter(&Tanks[Pending[i].Tank], Time);
+                Received++;
+                Pending.erase(Pending.begin() + i);
+            }
+            else
+                i++;
+
+        uint32_t Sleep = (Pending.empty() && (Time >= ListenUntil)) ? transmittersSleepTime(Time) : 0;
+        if (Sleep < SYNC_BENCH_MIN_SLEEP)
+        {
+            Awake += SYNC_BENCH_STEP;
+            Time += SYNC_BENCH_STEP;
+            continue;
+        }
+
+        // Light sleep until the timer, or until the start of a frame
+        uint32_t Wake = Time + Sleep;
+        if ((Next < Frames.size()) && (Frames[Next].Start < Wake))
+        {
+            Wake = Frames[Next++].Start;
+            ListenUntil = Wake + SYNC_LISTEN;
+            LostBySleep++;
+        }
+        Time = Wake;
+    }
+
+    printf("%-20s %6.1f %% awake %5u frames sent %5u received, %3u lost by the sleep (%.2f %%), %3u relearned\n",
+           sc->Name, Awake * 100.0 / SYNC_BENCH_TIME, (unsigned)Frames.size(), Received, LostBySleep,
+           LostBySleep * 100.0 / Frames.size(), (unsigned)(metricCounters[metricSyncMissed].load() - MissedStart));
+    check(Awake * 100.0 / SYNC_BENCH_TIME <= sc->MaxAwake, sc->Name, "awake too long");
+    check(LostBySleep * 100.0 / Frames.size() <= sc->MaxLost, sc->Name, "too many frames lost by the sleep");
+    check(Received + LostBySleep + Pending.size() == Frames.size(), sc->Name, "frame neither received nor lost");
+
+    // Empty the table for the next run
+    evictStaleTransmitters(SYNC_BENCH_TIME + TRANSMITTER_STALE_TIME + 1);
+}
+
+// Packed readings : capacity in RTC memory and cost of the packing
+static void runHistory()
+{
+    static tHistory History;
+    std::mt19937 rng(7);
+    const int Nb = 1000000;
+    std::vector<tFrame> Frames(1024);
+    std::vector<time_t> Times(1024);
+    int Errors = 0;
+
+    for (size_t i = 0; i < Frames.size(); i++)
+    {
+        Frames[i].IdNumber = rng() % 1000000;
+        Frames[i].Pressure = rng() % 4096;
+        Frames[i].Battery = (tBattery)(rng() % 4);
+        Frames[i].Corrected = rng() % 2;
+        Times[i] = HISTORY_EPOCH + rng() % 0x1FFFFFFF;
+    }
+
+    auto Start = std::chrono::steady_clock::now();
+    for (int n = 0; n < Nb; n++)
+        addHistory(&History, Times[n & 1023], &Frames[n & 1023]);
+    double Add = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - Start).count();
+
+    // Every reading still in the history, from the newest to the oldest
+    Start = std::chrono::steady_clock::now();
+    int NbRead = 0;
+    for (int Pass = 0; Pass < Nb / HISTORY_LENGTH; Pass++)
+        for (uint32_t Num = History.Count - 1; Num >= historyOldest(&History); Num--)
+        {
+            tReading r;
+            const tFrame *f = &Frames[Num & 1023];
+
+            if (!readHistory(&History, Num, &r) || (r.Num != Num) || (r.Time != Times[Num & 1023]) ||
+                (r.Id != f->IdNumber) || (r.Pressure != f->Pressure) || (r.Battery != f->Battery) || (r.Corrected != f->Corrected))
+                Errors++;
+            NbRead++;
+        }
+    double Read = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - Start).count();
+
+    printf("%-20s %d readings in %u bytes (%u bytes/reading) %6.1f ns/add %6.1f ns/read\n",
+           "history", HISTORY_LENGTH, (unsigned)sizeof(History), (unsigned)sizeof(tRecord), Add / Nb, Read / NbRead);
+    check(Errors == 0, "history", "reading corrupted");
+    check(sizeof(tRecord) == 8, "history", "reading not packed in 8 bytes");
+    check(NbRead == Nb / HISTORY_LENGTH * HISTORY_LENGTH, "history", "history not full");
+}
+
+// Dive profiles : pressure read every 5 s, consumption given by the profile
+typedef struct
+{
+    const char *Name;
+    float Rate1, Rate2; // bar/min - before and after ChangeTime
+    float ChangeTime;   // min
+    float Glitches;     // Part of the readings wrong by 20 bar
+    float RefillTime;   // min - tank changed for a full one, 0 for none
+    float MaxError;     // bar/min - bound of the mean error of the trend
+    float MaxReserve;   // min - bound of the mean error of the time to reserve
+} tDive;
+
+static void runConsumption(const tDive *dive)
+{
+    std::mt19937 rng(5);
+    std::normal_distribution<float> Noise(0, 0.3f);
+    std::uniform_real_distribution<float> Uniform(0, 1);
+    tConsumption Consumption = {};
+    const float Duration = 60;
+    float Bar = 200;
+    double Error = 0, ReserveError = 0;
+    int NbError = 0, NbReserve = 0, Glitches = 0, Updates = 0;
+    double Ns = 0;
+
+    for (float Time = 0; Time < Duration; Time += 5 / 60.0f)
+    {
+        float Rate = (Time < dive->ChangeTime) ? dive->Rate1 : dive->Rate2;
+
+        Bar -= Rate * 5 / 60;
+        if ((dive->RefillTime > 0) && (Time >= dive->RefillTime) && (Time < dive->RefillTime + 0.05f))
+            Bar = 230;
+
+        // Transmitter gives the pressure by steps of 2 PSI
+        float Read = Bar + Noise(rng);
+        if (Uniform(rng) < dive->Glitches)
+        {
+            Read += 20;
+            Glitches++;
+        }
+        Read = (int)(Read * 14.504f / 2) * 2 / 14.504f;
+
+        auto Start = std::chrono::steady_clock::now();
+        updateConsumption(&Consumption, Read, (uint32_t)(Time * 60000));
+        Ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - Start).count();
+        Updates++;
+
+        // Error once the trend had the time to follow the last change
+        bool Settled = (Time > 5) && ((Time < dive->ChangeTime) || (Time > dive->ChangeTime + 5)) &&
+                       ((dive->RefillTime == 0) || (Time < dive->RefillTime) || (Time > dive->RefillTime + 5));
+        if (Settled)
+        {
+            Error += fabs(Consumption.Trend - Rate);
+            NbError++;
+
+            float Reserve = timeToReserve(&Consumption, Bar, RESERVE_PRESSURE);
+            if (Reserve >= 0)
+            {
+                ReserveError += fabs(Reserve - (Bar - RESERVE_PRESSURE) / Rate);
+                NbReserve++;
+            }
+        }
+    }
+
+    printf("%-24s %6.1f ns/update %5.2f bar/min error %5.1f min to reserve error %4u/%-4d outliers\n",
+           dive->Name, Ns / Updates, Error / NbError, NbReserve ? ReserveError / NbReserve : -1,
+           (unsigned)Consumption.Outliers, Glitches);
+    check(Error / NbError <= dive->MaxError, dive->Name, "trend too far from the consumption");
+    check((NbReserve > 0) && (ReserveError / NbReserve <= dive->MaxReserve), dive->Name, "time to reserve too far");
+    check(Consumption.Outliers >= (uint32_t)Glitches, dive->Name, "glitch taken into the trend");
+}
+
+// Battery discharged at a constant rate, ADC samples with noise : filtered in the background with the DMA,
+// or one reading of 8 bits every 500 ms and its average over 5 readings, drawn each time as before
+#define BENCH_BATTERY_RATE 1000   // Hz - samples of the DMA
+#define BENCH_BATTERY_GAIN 0.757f // mV per step, 12 bits at 11 dB
+#define BENCH_BATTERY_MV 2.0f       // mV - bound of the mean error of the voltage, a step displayed is 10 mV
+#define BENCH_BATTERY_CHARGE 0.5f   // % - bound of the mean error of the charge
+#define BENCH_BATTERY_RUNTIME 10.0f // min - bound of the mean error of the runtime left
+#define BENCH_BATTERY_REDRAWS 100   // Voltage drawn at most that many times over the 4 h
+
+// Voltage of the cell for a charge, on the curve of the model
+static float batteryVolts(float charge)
+{
+    float Low = 3.0f, High = 4.3f;
+
+    for (int i = 0; i < 30; i++)
+    {
+        float Mid = (Low + High) / 2;
+        if (batteryCharge(Mid) < charge)
+            Low = Mid;
+        else
+            High = Mid;
+    }
+    return (Low + High) / 2;
+}
+
+static void runBattery(float noise)
+{
+    std::mt19937 rng(11);
+    std::normal_distribution<float> Noise(0, noise);
+    tBatteryMonitor Monitor;
+    const uint32_t Duration = 4 * 3600;        // s
+    const float Start = 0.9f, End = 0.1f;      // Charge
+    const float Rate = (Start - End) / Duration; // Charge lost per s
+    uint16_t Samples[BENCH_BATTERY_RATE / 2];
+    double Ns = 0, Error = 0, OldError = 0, ChargeError = 0, RuntimeError = 0;
+    int NbError = 0, NbRuntime = 0, Redraws = 0, OldRedraws = 0, Blocks = 0;
+    int Old[5] = {0}, OldNb = 0, OldSum = 0;
+
+    initBatteryMonitor(&Monitor, BENCH_BATTERY_GAIN, 0);
+
+    // Every 500 ms, like the job of loop()
+    for (uint32_t Ms = 0; Ms < Duration * 1000; Ms += 500)
+    {
+        float Charge = Start - Rate * Ms / 1000;
+        float Volts = batteryVolts(Charge);
+        float Raw = Volts * 1000 / BATTERY_DIVIDER / BENCH_BATTERY_GAIN;
+
+        for (uint16_t &Sample : Samples)
+            Sample = (uint16_t)std::min(4095.0f, std::max(0.0f, roundf(Raw + Noise(rng))));
+
+        auto Begin = std::chrono::steady_clock::now();
+        Blocks += addBatterySamples(&Monitor, Samples, BENCH_BATTERY_RATE / 2, Ms / 1000);
+        float Shown;
+        if (batteryDisplay(&Monitor, &Shown))
+            Redraws++;
+        Ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - Begin).count();
+
+        // Previous way : one sample of 8 bits, average of 5, drawn every time
+        int Read = (int)((Samples[0] >> 4) * 16 * BENCH_BATTERY_GAIN);
+        OldSum += Read - Old[OldNb % 5];
+        Old[OldNb++ % 5] = Read;
+        if (OldNb >= 5)
+            OldRedraws++;
+
+        if (Ms >= 600000)
+        {
+            Error += fabs(Monitor.Voltage - Volts);
+            OldError += fabs(OldSum * 3.0 / 5 / 1000 - Volts);
+            ChargeError += fabs(Monitor.Charge - Charge);
+            NbError++;
+
+            uint32_t Runtime = batteryRuntime(&Monitor);
+            if (Runtime > 0)
+            {
+                RuntimeError += fabs((double)Runtime - Charge / Rate);
+                NbRuntime++;
+            }
+        }
+    }
+
+    printf("battery noise %3.0f   %5.1f ns/sample %5.1f mV error (%5.1f mV before) %4.1f %% charge error "
+           "%5.1f min runtime error, %4d redraws (%d before)\n",
+           noise, Ns / (Blocks * BATTERY_DECIMATION), Error / NbError * 1000, OldError / NbError * 1000,
+           ChargeError / NbError * 100, NbRuntime ? RuntimeError / NbRuntime / 60 : -1.0, Redraws, OldRedraws);
+
+    char Name[32];
+    snprintf(Name, sizeof(Name), "battery noise %.0f", noise);
+    check(Error / NbError * 1000 <= BENCH_BATTERY_MV, Name, "voltage error too large");
+    check(ChargeError / NbError * 100 <= BENCH_BATTERY_CHARGE, Name, "charge error too large");
+    check((NbRuntime > 0) && (RuntimeError / NbRuntime / 60 <= BENCH_BATTERY_RUNTIME), Name, "runtime error too large");
+    check(Redraws <= BENCH_BATTERY_REDRAWS, Name, "voltage redrawn too often");
+}
+
+// Days of use : awake a few minutes after each button press, asleep in between
+// The time kept by the RTC timer is compared to the previous accounting : timer wake up every 5 s,
+// half a period added when woken by the button
+// After each sleep, the wall clock rebuilt from the time awake and the time asleep counted must be the true time
+static void runClock()
+{
+    std::mt19937 rng(3);
+    tClockStats Stats = {};
+    uint64_t Now = (uint64_t)CLOCK_DEFAULT_TIME * 1000000; // us - true time
+    uint64_t Old = Now;                                    // us - previous accounting
+    uint64_t Clock = Now;                                  // us - wall clock : time awake + time asleep counted
+    uint64_t Slept = 0, OldWakes = 0;
+    const int Nb = 10000;
+    int Mismatches = 0;
+
+    for (int n = 0; n < Nb; n++)
+    {
+        // Awake between 1 and 3 min, then asleep between 1 s and 2 h
+        uint64_t Awake = 60000000 + rng() % 120000000;
+        uint64_t Sleep = 1000000 + (uint64_t)rng() % 7200000000ULL;
+
+        Now += Awake;
+        Clock += Awake;
+        Old += Awake / 1000000 * 1000000; // micros() / 1000000 added when going to sleep
+        clockSleep(&Stats, Now);
+
+        uint64_t Counted = Stats.Slept;
+
+        Now += Sleep;
+        Slept += Sleep;
+        OldWakes += Sleep / (OLD_WAKE_PERIOD * 1000000);
+        Old += Sleep / (OLD_WAKE_PERIOD * 1000000) * OLD_WAKE_PERIOD * 1000000 + OLD_WAKE_PERIOD * 1000000 / 2;
+        clockWake(&Stats, Now);
+
+        Clock += Stats.Slept - Counted;
+        Mismatches += (Clock != Now);
+    }
+
+    // Reset instead of a wake up, then clock set backward during the sleep : no time asleep counted
+    tClockStats Reset = Stats;
+    clockWake(&Reset, Now + 1000000);
+    clockSleep(&Reset, Now);
+    clockWake(&Reset, Now - 1000000);
+
+    double OldError = ((double)Old - (double)Now) / 1e6;
+
+    printf("%-20s %d sleeps %8u wakes (%llu before) %d wall clock mismatches, previous accounting off by %.0f s\n",
+           "clock", Nb, (unsigned)Stats.Wakes, (unsigned long long)(Stats.Wakes + OldWakes), Mismatches, OldError);
+    printf("%-20s %u timer wake up avoided, ~%u J saved\n", "clock", (unsigned)Stats.AvoidedWakes,
+           (unsigned)(clockEnergySaved(&Stats) / 1000));
+    check(Mismatches == 0, "clock", "wall clock after a sleep different from the true time");
+    check((Stats.Slept == Slept) && (Stats.AvoidedWakes == OldWakes) && (Stats.Wakes == (uint32_t)Nb), "clock",
+          "time asleep wrong");
+    check((Reset.Slept == Stats.Slept) && (Reset.Wakes == Stats.Wakes) && (Reset.SleepStart == 0), "clock",
+          "time counted for a reset or a clock set backward");
+
+    // Clock of the system, read through the same calls as on the ESP32
+    time_t System = time(nullptr);
+    time_t Read = clockNow();
+    check((Read >= System) && (Read - System <= 1), "clock", "clockNow() different from the system time");
+}
+
+// Cost of the metrics left on : counter, histogram, export of /metrics
+static size_t MetricsBytes = 0;
+
+static void countBytes(const char *format, ...)
+{
+    char Buffer[256];
+    va_list Args;
+
+    va_start(Args, format);
+    MetricsBytes += vsnprintf(Buffer, sizeof(Buffer), format, Args);
+    va_end(Args);
+}
+
+static void runMetrics()
+{
+    const int Nb = 10000000;
+
+    auto Start = std::chrono::steady_clock::now();
+    for (int n = 0; n < Nb; n++)
+        countMetric(metricEdges);
+    double Count = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - Start).count();
+
+    Start = std::chrono::steady_clock::now();
+    for (int n = 0; n < Nb; n++)
+        observeMetric(histogramLoop, n & 0x3FFFF);
+    double Observe = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - Start).count();
+
+    Start = std::chrono::steady_clock::now();
+    exportMetrics(countBytes);
+    double Export = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - Start).count();
+
+    printf("%-20s %6.1f ns/count %6.1f ns/observe %6.1f us/export of %u bytes\n",
+           "metrics", Count / Nb, Observe / Nb, Export, (unsigned)MetricsBytes);
+}
+
+// Message of each frame : formatted by loop() as before, or added to the ring and formatted by the sending task
+// Printing to the USB and waiting for it are not counted in the old way, only the formatting
+static void runTrace()
+{
+    const int Nb = 1000000;
+    tTraceRing *Ring = new tTraceRing();
+    tTraceRecord Record;
+    char Text[TRACE_TEXT];
+    size_t Bytes = 0;
+
+    Ring->Verbosity = traceDebug;
+
+    auto Start = std::chrono::steady_clock::now();
+    for (int n = 0; n < Nb; n++)
+    {
+        int Length = snprintf(Text, sizeof(Text), "Time : %.1f, ", n / 1e6);
+        Length += snprintf(Text + Length, sizeof(Text) - Length, "ID : %06u, ", 123456 + n % 10);
+        Length += snprintf(Text + Length, sizeof(Text) - Length, "Pressure : %d PSI - %.2f bars, ", n % 2048 * 2, n % 2048 * 2 / 14.504);
+        Length += snprintf(Text + Length, sizeof(Text) - Length, "Battery : %s, ", batteryText(batteryGood));
+        Length += snprintf(Text + Length, sizeof(Text) - Length, "Checksum : %s\n", "OK");
+        Bytes += Length;
+    }
+    double Printf = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - Start).count();
+
+    double Add = 0, Format = 0;
+    for (int n = 0; n < Nb; n += TRACE_LENGTH)
+    {
+        Start = std::chrono::steady_clock::now();
+        for (int i = 0; i < TRACE_LENGTH; i++)
+        {
+            tTraceRecord *r = newTrace(Ring, traceFrame, n + i);
+            if (r)
+            {
+                r->Args[0] = 123456 + i % 10;
+                r->Args[1] = (n + i) % 2048;
+                r->Args[2] = batteryGood;
+                r->Args[3] = 1;
+                commitTrace(Ring);
+            }
+        }
+        auto Middle = std::chrono::steady_clock::now();
+        while (popTrace(Ring, &Record))
+            Bytes -= formatTrace(&Record, Text, sizeof(Text));
+        Add += std::chrono::duration<double, std::nano>(Middle - Start).count();
+        Format += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - Middle).count();
+    }
+
+    // Nobody reads : the ring is full and the next records are dropped, never waited for
+    for (int n = 0; n < 1000; n++)
+        if (newTrace(Ring, traceFrame, n))
+            commitTrace(Ring);
+
+    printf("%-20s %6.1f ns/frame printed before, %6.1f ns/frame added to the ring + %6.1f ns/frame formatted by the task, %u dropped when full\n",
+           "trace", Printf / Nb, Add / Nb, Format / Nb, (unsigned)Ring->Dropped.load());
+    check(Bytes == 0, "trace", "text different from the one printed before");
+    check(Ring->Dropped.load() == 1000 - TRACE_LENGTH, "trace", "record not dropped when the ring is full");
+
+    // Every type gives one line, even with the largest values
+    for (int Type = 0; Type < NB_TRACE_TYPES; Type++)
+    {
+        Record.Type = Type;
+        for (uint32_t &Arg : Record.Args)
+            Arg = 0xFFFFFFFF;
+        Record.Args[0] = 0;
+
+        int Length = formatTrace(&Record, Text, sizeof(Text));
+        check((Length > 0) && (Length < TRACE_TEXT - 1) && (Text[Length - 1] == '\n'), "trace", "type without its line");
+    }
+
+    delete Ring;
+}
+
+// Scheduler of loop() on a virtual clock : the wait ends on the next tick of 1 ms as with ulTaskNotifyTake()
+// and each job takes some time
+typedef struct
+{
+    uint32_t *Clock;  // us
+    uint32_t Period;  // us, JOB_DONE for a one-shot
+    uint32_t Cost;    // us
+    uint32_t Runs;
+    uint32_t LastRun; // us
+    int Order;        // Rank of the run, one-shot jobs
+} tBenchJob;
+
+static int BenchOrder = 0;
+
+static uint32_t benchJob(void *context)
+{
+    tBenchJob *j = (tBenchJob *)context;
+
+    j->Runs++;
+    j->LastRun = *j->Clock;
+    j->Order = BenchOrder++;
+    *j->Clock += j->Cost;
+
+    return j->Period;
+}
+
+// Virtual loop() until the clock reaches end
+static void runVirtualLoop(tScheduler *s, uint32_t *clock, uint32_t end)
+{
+    while ((int32_t)(end - *clock) > 0)
+    {
+        runJobs(s, *clock);
+
+        uint32_t Wait = nextJob(s, *clock);
+        uint32_t Ticks = (Wait + 999) / 1000;
+        uint32_t Wake = (*clock / 1000 + Ticks) * 1000;
+
+        if (Wait > 0)
+        {
+            s->Idle += Wake - *clock;
+            *clock = Wake;
+        }
+    }
+}
+
+static void runScheduler()
+{
+    tScheduler *s = new tScheduler();
+    int Errors = 0;
+
+    // Jobs of loop() : web, button, battery, tanks, report, for 60 s
+    const uint32_t Periods[5] = {2000, 20000, 500000, 3000000, 10000000};
+    tBenchJob Jobs[SCHEDULER_JOBS];
+    uint32_t Clock = 0xFFFFFFFF - 20000000; // micros() wraps during the run
+
+    resetSchedulerStats(s, Clock);
+    for (int i = 0; i < 5; i++)
+    {
+        Jobs[i] = {&Clock, Periods[i], 50, 0, 0, 0};
+        addJob(s, "periodic", benchJob, &Jobs[i], Clock, Periods[i]);
+    }
+
+    // Sleep timeout pushed back by the frames until 30 s, then cancelled job never run
+    Jobs[5] = {&Clock, JOB_DONE, 0, 0, 0, 0};
+    int Sleep = addJob(s, "sleep", benchJob, &Jobs[5], Clock, 60000000);
+    Jobs[6] = {&Clock, JOB_DONE, 0, 0, 0, 0};
+    int Cancelled = addJob(s, "cancelled", benchJob, &Jobs[6], Clock, 1000000);
+    cancelJob(s, Cancelled);
+
+    uint32_t Start = Clock;
+    for (int t = 0; t < 3; t++)
+    {
+        runVirtualLoop(s, &Clock, Clock + 10000000);
+        scheduleJob(s, Sleep, Clock, 60000000);
+    }
+    uint32_t LastPush = Clock;
+    runVirtualLoop(s, &Clock, Start + 100000000);
+
+    for (int i = 0; i < 5; i++)
+        if (abs((int)Jobs[i].Runs - (int)(100000000 / Periods[i])) > 1)
+            Errors++;
+    if ((Jobs[5].Runs != 1) || (Jobs[5].LastRun - LastPush - 60000000 > 1000) || (Jobs[6].Runs != 0))
+        Errors++;
+
+    double Idle = s->Idle * 100.0 / (Clock - s->StatsStart);
+    double Jitter = s->Runs ? (double)s->JitterSum / s->Runs : 0;
+    uint32_t MaxJitter = s->MaxJitter;
+
+    // One-shot jobs run in the order of their deadlines, capacity limited
+    tScheduler *Order = new tScheduler();
+    std::mt19937 rng(7);
+    uint32_t OrderClock = 0;
+    for (int i = 0; i < SCHEDULER_JOBS; i++)
+    {
+        Jobs[i] = {&OrderClock, JOB_DONE, 0, 0, 0, 0};
+        addJob(Order, "one-shot", benchJob, &Jobs[i], 0, rng() % 1000000);
+    }
+    if (addJob(Order, "extra", benchJob, &Jobs[0], 0, 0) != -1)
+        Errors++;
+    BenchOrder = 0;
+    runVirtualLoop(Order, &OrderClock, 2000000);
+    for (int i = 0; i < SCHEDULER_JOBS; i++)
+        for (int k = 0; k < SCHEDULER_JOBS; k++)
+            if ((Order->Jobs[i].Deadline < Order->Jobs[k].Deadline) != (Jobs[i].Order < Jobs[k].Order) && (i != k))
+                Errors++;
+
+    // Cost of a pass with every job due
+    tScheduler *Due = new tScheduler();
+    uint32_t DueClock = 0;
+    for (int i = 0; i < SCHEDULER_JOBS; i++)
+    {
+        Jobs[i] = {&DueClock, 1000, 0, 0, 0, 0};
+        addJob(Due, "due", benchJob, &Jobs[i], 0, i);
+    }
+    const int Nb = 200000;
+    auto Begin = std::chrono::steady_clock::now();
+    for (int n = 0; n < Nb; n++)
+    {
+        DueClock += 1000;
+        runJobs(Due, DueClock);
+    }
+    double Ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - Begin).count();
+
+    printf("%-20s %6.1f ns/job run, 100 s virtual : jitter mean %.0f us max %u us, idle %.1f %%\n",
+           "scheduler", Ns / Nb / SCHEDULER_JOBS, Jitter, (unsigned)MaxJitter, Idle);
+    check(Errors == 0, "scheduler", "job run at the wrong time, in the wrong order or over the capacity");
+    // Wait rounded up to the tick of 1 ms, then the 4 other jobs of 50 us due at the same time
+    check(MaxJitter <= 1000 + 4 * 50, "scheduler", "job run too late after its deadline");
+    check(Idle >= 95, "scheduler", "loop() not waiting between the deadlines");
+
+    delete Due;
+    delete Order;
+    delete s;
+}
+
+// Flash log on files of the host : append by blocks as on the ESP32, queries, recovery of a torn write
+#define LOG_BENCH_DIR "/tmp/mh8a-log-bench"
+
+typedef struct
+{
+    int Found;
+    uint32_t NextNum;
+    int OrderErrors;
+} tLogCheck;
+
+static void checkLog(const tReading *r, void *context)
+{
+    tLogCheck *c = (tLogCheck *)context;
+
+    if ((c->Found > 0) && (r->Num != c->NextNum))
+        c->OrderErrors++;
+    c->NextNum = r->Num + 1;
+    c->Found++;
+}
+
+static void runLog()
+{
+    static tHistory History;
+    static tLog Log;
+    std::mt19937 rng(11);
+    std::vector<tFrame> Tanks(24);
+    const int Nb = 20000;
+    const int Block = 128;
+    char Path[64];
+
+    for (int i = 0; i < LOG_SEGMENTS; i++)
+    {
+        snprintf(Path, sizeof(Path), "%s/seg%02d", LOG_BENCH_DIR, i);
+        remove(Path);
+    }
+    remove(LOG_BENCH_DIR "/index");
+
+    for (auto &f : Tanks)
+    {
+        f.IdNumber = rng() % 1000000;
+        f.Pressure = 1500;
+        f.Battery = batteryGood;
+    }
+
+    openLog(&Log, LOG_BENCH_DIR);
+
+    // One reading every 10 s, written by blocks
+    time_t Time = 1735689600;
+    uint32_t Logged = 0;
+    double Append = 0;
+
+    for (int n = 0; n < Nb; n++)
+    {
+        addHistory(&History, Time + n * 10, &Tanks[rng() % Tanks.size()]);
+
+        if (History.Count - Logged >= Block)
+        {
+            auto Start = std::chrono::steady_clock::now();
+            Logged += appendLog(&Log, &History, Logged);
+            Append += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - Start).count();
+        }
+    }
+
+    printf("%-20s %d readings %8.0f readings/s %8.1f us/block of %d\n",
+           "log append", Logged, Logged / Append * 1e6, Append / (Logged / Block), Block);
+    check(Logged == (uint32_t)Nb / Block * Block, "log append", "block not written");
+
+    // 1 hour among the last readings, then one tank over everything
+    for (int Query = 0; Query < 2; Query++)
+    {
+        tLogCheck Check = {};
+        int Read;
+        time_t From = (Query == 0) ? Time + (Nb - 2000) * 10 : 0;
+        time_t To = (Query == 0) ? From + 3600 : Time + Nb * 10;
+        uint32_t Id = (Query == 0) ? 0 : Tanks[0].IdNumber;
+
+        auto Start = std::chrono::steady_clock::now();
+        queryLog(&Log, From, To, Id, checkLog, &Check, &Read);
+        double Us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - Start).count();
+
+        printf("%-20s %-8s %8.1f us %6d found %6d read\n",
+               "log query", (Query == 0) ? "1 hour" : "1 tank", Us, Check.Found, Read);
+        if (Query == 0)
+        {
+            // 1 reading every 10 s, both ends included, only the segments of this hour read
+            check((Check.OrderErrors == 0) && (Check.Found == 3600 / 10 + 1), "log query", "reading missing in the hour");
+            check(Read < (int)Logged / 10, "log query", "hour not found from the index");
+        }
+        else
+            check(Check.Found > 0, "log query", "no reading of the tank");
+    }
+
+    // Reset during a write : end of a record in the last segment
+    uint32_t Next = nextLogNum(&Log);
+
+    snprintf(Path, sizeof(Path), "%s/seg%02d", LOG_BENCH_DIR, Log.Active);
+    FILE *f = fopen(Path, "ab");
+    fwrite("torn!!!", 7, 1, f);
+    fclose(f);
+
+    auto Start = std::chrono::steady_clock::now();
+    openLog(&Log, LOG_BENCH_DIR);
+    double Us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - Start).count();
+
+    // Log must go on right after the last valid reading
+    addHistory(&History, Time + Nb * 10, &Tanks[0]);
+    appendLog(&Log, &History, Logged);
+
+    tLogCheck Check = {};
+    int Read;
+    queryLog(&Log, 0, Time + Nb * 20, 0, checkLog, &Check, &Read);
+
+    printf("%-20s %8.1f us %6u bytes removed %6d readings kept\n",
+           "log recovery", Us, (unsigned)Log.Recovered, Check.Found);
+    check((Next == Logged) && (Check.OrderErrors == 0) && (Check.NextNum == History.Count) &&
+              (Check.Found == (LOG_SEGMENTS - 1) * LOG_SEGMENT_READINGS + (int)Log.Index[Log.Active].Count),
+          "log recovery", "log corrupted after a torn write");
+    check(Log.Recovered == 7, "log recovery", "torn record not removed");
+}
+
+// Local clients of the SSE fan-out : the last one never reads its socket
+static void runEvents(int nbFast)
+{
+    const int Nb = 20000;
+    static tEventRing Ring;
+    int Sockets[EVENT_CLIENTS][2];
+    std::string Received[EVENT_CLIENTS];
+    int NextId[EVENT_CLIENTS] = {};
+    std::vector<unsigned long> Published(Nb);
+    std::vector<double> Latency;
+    int OrderErrors = 0;
+
+    for (int i = 0; i <= nbFast; i++)
+    {
+        socketpair(AF_UNIX, SOCK_STREAM, 0, Sockets[i]);
+        int Size = 4096;
+        setsockopt(Sockets[i][0], SOL_SOCKET, SO_SNDBUF, &Size, sizeof(Size));
+        addEventClient(&Ring, Sockets[i][0]);
+    }
+
+    double Pump = 0;
+
+    for (int n = 0; n < Nb; n++)
+    {
+        char Event[EVENT_LENGTH];
+        int Length = snprintf(Event, sizeof(Event),
+                              "id: %d\ndata: {\"Num\":\"%d\",\"Time\":\"01/01/25 - 00:00:00\",\"ID\":\"123456\","
+                              "\"Pressure\":\"3000 PSI - 206.84 bars\",\"Battery\":\"Good\"}\n\n", n, n);
+
+        // Frame completed now : same time base as micros() on the ESP32
+        auto Start = std::chrono::steady_clock::now();
+        Published[n] = micros();
+        publishEvent(&Ring, Event, Length, Published[n]);
+        pumpEvents(&Ring, micros());
+        Pump += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - Start).count();
+
+        // What the browsers receive
+        for (int i = 0; i < nbFast; i++)
+        {
+            char Buffer[8192];
+            ssize_t r;
+
+            while ((r = recv(Sockets[i][1], Buffer, sizeof(Buffer), MSG_DONTWAIT)) > 0)
+                Received[i].append(Buffer, r);
+
+            size_t End;
+            while ((End = Received[i].find("\n\n")) != std::string::npos)
+            {
+                int Id = atoi(Received[i].c_str() + 4);
+
+                if (Id != NextId[i])
+                    OrderErrors++;
+                NextId[i] = Id + 1;
+                Latency.push_back(micros() - Published[Id]);
+                Received[i].erase(0, End + 2);
+            }
+        }
+    }
+
+    std::sort(Latency.begin(), Latency.end());
+
+    printf("%-20s %d+1 clients %8.1f ns/event %6.1f us latency p99 %6.1f us max %6u lost by the slow client\n",
+           "events", nbFast, Pump / Nb, Latency[Latency.size() * 99 / 100], Latency.back(),
+           (unsigned)Ring.Client[nbFast].Dropped);
+    check((OrderErrors == 0) && (Latency.size() == (size_t)Nb * nbFast), "events", "event lost or out of order for a fast client");
+    check(Ring.Client[nbFast].Dropped > 0, "events", "slow client never dropped : the fast ones waited for it");
+
+    for (int i = 0; i <= nbFast; i++)
+    {
+        close(Sockets[i][0]);
+        close(Sockets[i][1]);
+    }
+}
+
+// Edges of the stream recorded as by the interrupt, written as /capture.bin, read back and replayed
+static void writeFile(const uint8_t *data, size_t length, void *context)
+{
+    std::vector<uint8_t> *File = (std::vector<uint8_t> *)context;
+
+    File->insert(File->end(), data, data + length);
+}
+
+static void runAll(const tStream *stream, tRunResults *results);
+
+static void runCapture(const tStream *stream)
+{
+    tRawCapture *Capture = new tRawCapture();
+    std::vector<uint8_t> File;
+    size_t Nb = stream->Edges.size();
+
+    Capture->Edges = new uint32_t[RAW_CAPTURE_EDGES];
+
+    auto Start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < Nb; i++)
+    {
+        recordEdge(Capture, stream->Edges[i]);
+        if ((i & 63) == 0)
+            moveRawEdges(Capture);
+    }
+    moveRawEdges(Capture);
+    double Record = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - Start).count();
+
+    Start = std::chrono::steady_clock::now();
+    writeRawCapture(Capture, writeFile, &File);
+    double Write = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - Start).count();
+
+    size_t Count = rawCaptureCount(File.data(), File.size());
+    std::vector<uint32_t> Edges(Count);
+    bool Same = (Count == RAW_CAPTURE_EDGES) && (decodeRawCapture(File.data(), File.size(), Edges.data(), Count) == Count) &&
+                std::equal(Edges.begin(), Edges.end(), stream->Edges.end() - Count);
+
+    printf("%-20s %6.1f ns/edge recorded %8zu edges in %zu bytes (%.2f bytes/edge) %8.0f us to write\n",
+           "raw capture", Record / Nb, Count, File.size(), (double)File.size() / Count, Write);
+    check(Same, "raw capture", "edges replayed different from the edges recorded");
+    check(Capture->Lost.load() == 0, "raw capture", "edge lost with a move every 64 edges");
+
+    // Download : the next move acknowledges the pause, then the edges are dropped instead of written
+    uint32_t Pause = Capture->PauseRequest.fetch_add(1) + 1;
+    uint32_t Written = Capture->Head.load();
+    moveRawEdges(Capture);
+    recordEdge(Capture, stream->Edges[Nb - 1] + 100);
+    moveRawEdges(Capture);
+    check((Capture->PauseAck.load() == Pause) && (Capture->Head.load() == Written) && (Capture->Lost.load() == 1),
+          "raw capture", "ring written after the pause was acknowledged");
+    Capture->PauseRequest.fetch_add(1);
+
+    tStream Replay;
+    tRunResults Results;
+    Replay.Name = "raw capture replay";
+    edgesStream(&Replay, Edges.data(), Count);
+    runAll(&Replay, &Results);
+
+    delete[] Capture->Edges;
+    delete Capture;
+}
+
+// Signal of the receiver sampled by the ADC (CAPTURE_ADC) : carrier during the bursts, offset and noise
+// Only the detection of the carrier is timed, the pauses found are then decoded : at least minOk % of the frames
+// With battery, 1 sample out of ADC_PATTERN is the battery : its slot is the mean of the others, as capture_adc.cpp does
+#define ADC_CHUNK 4096
+#define ADC_AMPLITUDE 200.0f // ADC steps
+
+static void runCarrier(const tStream *stream, float noise, int minOk, bool battery)
+{
+    std::mt19937 rng(99);
+    std::normal_distribution<float> Noise(0, noise);
+    tCarrierDetector *Detector = new tCarrierDetector();
+    std::vector<uint16_t> Pauses;
+    int16_t Samples[ADC_CHUNK];
+    uint16_t Found[ADC_CHUNK / CARRIER_BLOCK];
+    size_t Edge = 0;
+    double Ns = 0;
+    int32_t Sum = 0; // Samples of the carrier since the last slot of the battery
+
+    initCarrierDetector(Detector);
+
+    uint64_t NbSamples = (uint64_t)stream->Edges.back() * CARRIER_RATE / 1000000 + CARRIER_RATE / 10;
+    for (uint64_t k = 0; k < NbSamples; k += ADC_CHUNK)
+    {
+        for (int i = 0; i < ADC_CHUNK; i++)
+        {
+            double Time = (k + i) * 1e6 / CARRIER_RATE;
+
+            while ((Edge + 1 < stream->Edges.size()) && (stream->Edges[Edge + 1] <= Time))
+                Edge++;
+
+            bool Carrier = (stream->Edges[Edge] <= Time) && (Time - stream->Edges[Edge] < CARRIER_PERIOD);
+            float x = 2048 + 100 * sinf(Time * 2e-6f * (float)M_PI) + Noise(rng); // Offset moving slowly
+            if (Carrier)
+                x += ADC_AMPLITUDE * sin(2 * M_PI * fmod(CARRIER_FREQUENCY * Time * 1e-6, 1));
+
+            if (battery && ((k + i) % ADC_PATTERN == ADC_PATTERN - 1))
+            {
+                Samples[i] = (int16_t)(Sum / (ADC_PATTERN - 1));
+                Sum = 0;
+            }
+            else
+            {
+                Samples[i] = std::min(std::max(lroundf(x), 0L), 4095L);
+                Sum += Samples[i];
+            }
+        }
+
+        auto Start = std::chrono::steady_clock::now();
+        int Nb = detectCarrier(Detector, Samples, ADC_CHUNK, Found, ADC_CHUNK / CARRIER_BLOCK);
+        Ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - Start).count();
+
+        Pauses.insert(Pauses.end(), Found, Found + Nb);
+    }
+
+    // Same decoding as the RMT : a pause longer than the end of frame ends the frame
+    tStreamDecoder *Decoder = new tStreamDecoder();
+    tFrame Frame;
+    tReject Reason;
+
+    Decoder->Mode = decoderAdaptive;
+    Pauses.push_back(0xFFFF);
+    for (uint16_t Delta : Pauses)
+    {
+        streamPulse(Decoder, Delta, &Frame);
+        if ((Delta > TIME_END_FRAME) && (Decoder->Burst.Length > 0))
+        {
+            if (!streamRetime(Decoder, &Frame))
+                streamCorrect(Decoder, &Frame);
+            streamEndOfFrame(Decoder, &Reason);
+        }
+    }
+
+    char Name[32];
+    double NsSample = Ns / NbSamples;
+    snprintf(Name, sizeof(Name), "carrier noise %.0f%s", noise, battery ? " bat" : "");
+    printf("%-20s %8.0f Msamples/s %6.2f ns/sample %6.2f %% CPU at %d Hz %6u/%d frames ok\n",
+           Name, 1e3 / NsSample, NsSample, NsSample * CARRIER_RATE * 1e-7, CARRIER_RATE,
+           Decoder->Stream.Accepted, stream->Frames);
+    check(Decoder->Stream.Accepted >= (uint32_t)(stream->Frames * minOk / 100), Name, "not enough frames decoded");
+    check(Decoder->Stream.Accepted <= (uint32_t)stream->Frames, Name, "more frames than sent");
+
+    delete Decoder;
+    delete Detector;
+}
+
+static void runAll(const tStream *stream, tRunResults *results)
+{
+    run(stream, results);
+    runReplay(stream, decoderFixed, &results->Fixed);
+    runReplay(stream, decoderAdaptive, &results->Adaptive);
+}
+
+int main(int argc, char **argv)
+{
+    tStream Clean, Noisy, Drift;
+
+    syntheticStream(&Clean, "synthetic clean", false, 0);
+    syntheticStream(&Noisy, "synthetic noisy", true, 0);
+    syntheticStream(&Drift, "synthetic drift 20%", false, 20);
+
+    runRingStress();
+    runDecode();
+    runLegacy();
+    runUnknownId();
+    int Shared = runTwoDrifts(false);
+    check(runTwoDrifts(true) > Shared, "2 drifts", "windows per ID not better than the shared ones");
+    runCorrect();
+    runTransmitters(24);
+    runTransmitters(48);
+    runPinnedTank();
+
+    const tSyncScenario Scenarios[] = {
+        {"sync 2 tanks", 2, {5000, 5030, 0}, {0, 0, 0}, 10, 0, 15, 0},
+        {"sync 2 tanks 3% lost", 2, {5000, 5030, 0}, {0, 0, 0}, 10, 0.03f, 30, 0.5f},
+        {"sync 3 tanks joining", 3, {5000, 5030, 4000}, {0, 0, 1500000}, 30, 0.01f, 25, 0.5f},
+    };
+    for (const tSyncScenario &Scenario : Scenarios)
+        runSync(&Scenario);
+    runEvents(EVENT_CLIENTS - 1);
+    runHistory();
+    runLog();
+    runClock();
+    for (float Noise : {2.0f, 8.0f, 20.0f})
+        runBattery(Noise);
+    runMetrics();
+    runTrace();
+    runScheduler();
+
+    const tDive Dives[] = {
+        {"dive steady 1.5 bar/min", 1.5f, 1.5f, 0, 0, 0, 0.05f, 1},
+        {"dive descent 3 then 1.2", 3.0f, 1.2f, 8, 0, 0, 0.15f, 5},
+        {"dive 2% glitches", 1.5f, 1.5f, 0, 0.02f, 0, 0.05f, 1},
+        {"dive tank changed", 1.5f, 1.5f, 0, 0, 30, 0.05f, 1},
+    };
+    for (const tDive &Dive : Dives)
+        runConsumption(&Dive);
+    // Sliding window : every clean frame, and more noisy frames than the decoding of the whole burst
+    tRunResults Results;
+    runAll(&Clean, &Results);
+    check((Results.Stream.Accepted == (uint32_t)Clean.Frames) && (Results.Gap.Accepted == (uint32_t)Clean.Frames) &&
+              (Results.Fixed.Accepted == (uint32_t)Clean.Frames) && (Results.Adaptive.Accepted == (uint32_t)Clean.Frames),
+          Clean.Name, "clean frame not decoded");
+    runAll(&Noisy, &Results);
+    check(Results.Stream.Accepted > Results.Gap.Accepted, Noisy.Name, "sliding window not better than the whole burst");
+    check(Results.Stream.Accepted >= (uint32_t)Noisy.Frames * 70 / 100, Noisy.Name, "less than 70 % of the frames");
+    // Pauses 20 % longer : out of the fixed windows, followed by the adaptive ones
+    runAll(&Drift, &Results);
+    check((Results.Stream.Accepted >= (uint32_t)Drift.Frames * 99 / 100) &&
+              (Results.Adaptive.Accepted >= (uint32_t)Drift.Frames * 99 / 100),
+          Drift.Name, "adaptive windows did not follow the drift");
+    check(Results.Fixed.Accepted == 0, Drift.Name, "fixed windows changed by the drift");
+    runCapture(&Noisy);
+    // The last noise level hides the carrier
+    runCarrier(&Clean, 0, 99, false);
+    runCarrier(&Clean, 50, 90, false);
+    runCarrier(&Clean, 100, 15, false);
+    runCarrier(&Clean, 150, 0, false);
+    runCarrier(&Clean, 0, 99, true);
+    runCarrier(&Clean, 50, 90, true);
+
+    for (int i = 1; i < argc; i++)
+    {
+        tStream Recorded;
+
+        if (recordedStream(&Recorded, argv[i]))
+            runAll(&Recorded, &Results);
+        else
+            printf("%s : cannot be read\n", argv[i]);
+    }
+
+    printf("%d failed\n", Failures);
+    return (Failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,59 @@
+#include "capture.h"
+
+// Fake backend of the host build : pauses are replayed from an array, as the RMT would deliver them
+static const uint16_t *Durations = NULL;
+static size_t NbDurations = 0;
+static size_t Pos = 0;
+static long Time = 0;
+
+void replayCapture(const uint16_t *durations, size_t nb)
+{
+    Durations = durations;
+    NbDurations = nb;
+    Pos = 0;
+    Time = 0;
+}
+
+void initCapture()
+{
+}
+
+bool readPulse(uint16_t *delta)
+{
+    if (Pos >= NbDurations)
+        return false;
+
+    *delta = Durations[Pos++];
+    Time += *delta;
+
+    return true;
+}
+
+long lastEdgeTime()
+{
+    return Time;
+}
+
+uint32_t captureOverflow()
+{
+    return 0;
+}
+
+void flushCapture()
+{
+    Pos = NbDurations;
+}
+
+bool captureSleep()
+{
+    return false;
+}
+
+void captureWake()
+{
+}
+
+tRawCapture *getRawCapture()
+{
+    return nullptr;
+}
@@ -0,0 +1,14 @@
+#include <chrono>
+#include "hal.h"
+
+static const auto Boot = std::chrono::steady_clock::now();
+
+unsigned long micros()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - Boot).count();
+}
+
+unsigned long millis()
+{
+    return micros() / 1000;
+}
@@ -0,0 +1,70 @@
+#include "legacy_decoder.h"
+
+// Same code as the first version of MH8A.cpp, String replaced by std::string :
+// substring(from, to) is substr(from, to - from)
+static std::string substring(const std::string &s, int from, int to)
+{
+    return s.substr(from, to - from);
+}
+
+// For tank ID, the protocol is using a dedicated coding for each number
+// This function will replace the 4 bits of each digit by its integer value
+static std::string GetChar(const std::string &s)
+{
+    if (s == "1010")
+        return "0";
+    else if (s == "1011")
+        return "1";
+    else if (s == "1100")
+        return "2";
+    else if (s == "0011")
+        return "3";
+    else if (s == "1101")
+        return "4";
+    else if (s == "0101")
+        return "5";
+    else if (s == "0110")
+        return "6";
+    else if (s == "0111")
+        return "7";
+    else if (s == "1110")
+        return "8";
+    else if (s == "1001")
+        return "9";
+    else
+        return "!";
+}
+
+bool legacyDecode(const std::string &frameToBeDecoded, tLegacyFrame *frame)
+{
+    // If length is not the good one, exit
+    if (frameToBeDecoded.length() != 58)
+        return false;
+
+    // For ID, 6 digits to be replace with the lookup table
+    frame->ID = "";
+    for (int i = 0; i < 6; i++)
+        frame->ID += GetChar(substring(frameToBeDecoded, 10 + i * 4, 10 + 4 + i * 4));
+
+    // Pressure is encoded in PSI - 12bits
+    // The value in the frame is half of the real value
+    frame->Pressure = std::stoi(substring(frameToBeDecoded, 34, 46), nullptr, 2);
+
+    // Battery status can be Good, Low, Critical with a specific coding
+    std::string Batt = substring(frameToBeDecoded, 46, 50);
+    frame->Battery = (Batt == "0000") ? "Good" : (Batt == "0010") ? "Low"
+                                             : (Batt == "0001")   ? "Critical"
+                                                                  : "Unknown";
+
+    // Checksum is calculated as following :
+    // Remove the 2 first bits (Preamble)
+    // Add the integer value of each 4 bits (12 nibbles)
+    frame->ChecksumCalc = 0;
+    for (int i = 0; i < 12; i++)
+        frame->ChecksumCalc += std::stoi(substring(frameToBeDecoded, 2 + i * 4, 2 + 4 + i * 4), nullptr, 2);
+
+    // Checksum is located in the 8 last bits of the frame
+    frame->ChecksumMsg = std::stoi(substring(frameToBeDecoded, 50, 58), nullptr, 2);
+
+    return true;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <string>
+
+// Decoder of the first version, working on the bits as a string of '0' and '1'
+// Only built on the host, as the reference of decodeFrame()
+typedef struct
+{
+    std::string ID;
+    int Pressure;
+    std::string Battery;
+    int ChecksumCalc;
+    int ChecksumMsg;
+} tLegacyFrame;
+
+// Return false if the length is not the good one
+bool legacyDecode(const std::string &frameToBeDecoded, tLegacyFrame *frame);
@@ -0,0 +1,116 @@
+#include <string.h>
+#include "rawcapture.h"
+
+void moveRawEdges(tRawCapture *c)
+{
+    uint32_t Pause = c->PauseRequest.load(std::memory_order_acquire);
+    uint32_t Tail = c->StagingTail.load(std::memory_order_relaxed);
+    uint32_t Head = c->StagingHead.load(std::memory_order_acquire);
+
+    if ((c->Edges != nullptr) && (Tail != Head))
+    {
+        // Nothing is written while the ring is read
+        if (Pause & 1)
+            c->Lost.fetch_add(Head - Tail, std::memory_order_relaxed);
+        else
+        {
+            uint32_t Ring = c->Head.load(std::memory_order_relaxed);
+
+            for (uint32_t i = Tail; i != Head; i++)
+                c->Edges[Ring++ & (RAW_CAPTURE_EDGES - 1)] = c->Staging[i & (RAW_STAGING_EDGES - 1)];
+
+            c->Head.store(Ring, std::memory_order_release);
+        }
+
+        c->StagingTail.store(Head, std::memory_order_release);
+    }
+
+    // Moves started before the request are over
+    c->PauseAck.store(Pause, std::memory_order_release);
+}
+
+size_t writeRawCapture(const tRawCapture *c, tRawWrite write, void *context)
+{
+    uint8_t Block[256];
+    size_t Length = 0, Total = 0;
+    uint32_t Head = c->Head.load(std::memory_order_acquire);
+    uint32_t Count = (Head > RAW_CAPTURE_EDGES) ? RAW_CAPTURE_EDGES : Head;
+
+    if ((c->Edges == nullptr) || (Count == 0))
+        return 0;
+
+    uint32_t Index = Head - Count;
+    uint32_t Last = c->Edges[Index & (RAW_CAPTURE_EDGES - 1)];
+    tRawHeader Header = {RAW_CAPTURE_MAGIC, RAW_CAPTURE_VERSION, {0, 0, 0}, Count, Last};
+
+    write((const uint8_t *)&Header, sizeof(Header), context);
+    Total += sizeof(Header);
+
+    for (Index++; Index != Head; Index++)
+    {
+        uint32_t Time = c->Edges[Index & (RAW_CAPTURE_EDGES - 1)];
+
+        Length += encodeDelta(Block + Length, Time - Last);
+        Last = Time;
+
+        if (Length > sizeof(Block) - 5)
+        {
+            write(Block, Length, context);
+            Total += Length;
+            Length = 0;
+        }
+    }
+
+    write(Block, Length, context);
+    Total += Length;
+
+    return Total;
+}
+
+size_t rawCaptureCount(const uint8_t *data, size_t size)
+{
+    tRawHeader Header;
+
+    if (size < sizeof(Header))
+        return 0;
+
+    memcpy(&Header, data, sizeof(Header));
+    if ((Header.Magic != RAW_CAPTURE_MAGIC) || (Header.Version != RAW_CAPTURE_VERSION))
+        return 0;
+
+    return Header.Count;
+}
+
+size_t decodeRawCapture(const uint8_t *data, size_t size, uint32_t *edges, size_t max)
+{
+    tRawHeader Header;
+    size_t Count = rawCaptureCount(data, size);
+
+    if ((Count == 0) || (Count > max))
+        return 0;
+
+    memcpy(&Header, data, sizeof(Header));
+
+    size_t Pos = sizeof(Header);
+    uint32_t Time = Header.First;
+
+    edges[0] = Time;
+    for (size_t n = 1; n < Count; n++)
+    {
+        uint32_t Delta = 0;
+        int Shift = 0;
+
+        do
+        {
+            if ((Pos >= size) || (Shift > 28))
+                return 0;
+            Delta |= (uint32_t)(data[Pos] & 0x7F) << Shift;
+            Shift += 7;
+        } while (data[Pos++] & 0x80);
+
+        Time += Delta;
+        edges[n] = Time;
+    }
+
+    return Count;
+}
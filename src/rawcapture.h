@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// Raw capture : time of every edge seen by the interrupt, kept in PSRAM to be replayed on the host
+// The interrupt writes in a small buffer of internal RAM (PSRAM cannot be used while the flash is written),
+// the decoding task moves the edges to the ring in PSRAM
+// Off by default : POST /capture?on=1 starts it, or build with -D RAW_CAPTURE_ON=1 to record from the boot
+#define RAW_STAGING_EDGES 1024   // Power of 2 - 4 kB of internal RAM
+#define RAW_CAPTURE_EDGES 262144 // Power of 2 - 1 MB of PSRAM, ~120 frames with the edges of the carrier
+
+#ifndef RAW_CAPTURE_ON
+#define RAW_CAPTURE_ON 0
+#endif
+
+// File : header then the delta between 2 edges in LEB128 (7 bits per byte, bit 7 set when a byte follows)
+// Edges of the carrier are 26 us apart : most deltas take 1 byte
+#define RAW_CAPTURE_MAGIC 0x4338484D // "MH8C"
+#define RAW_CAPTURE_VERSION 1
+
+typedef struct __attribute__((packed))
+{
+    uint32_t Magic;
+    uint8_t Version;
+    uint8_t Reserved[3];
+    uint32_t Count; // # of edges
+    uint32_t First; // Time of the first edge - us
+} tRawHeader;
+
+typedef struct
+{
+    uint32_t Staging[RAW_STAGING_EDGES];
+    std::atomic<uint32_t> StagingHead;  // Only written by the interrupt
+    std::atomic<uint32_t> StagingTail;  // Only written by the decoding task
+    uint32_t *Edges;                    // Ring in PSRAM, nullptr when there is no PSRAM
+    std::atomic<uint32_t> Head;         // # of edges moved to the ring
+    std::atomic<uint32_t> Lost;         // # of edges dropped : staging full or capture paused
+    std::atomic<uint32_t> PauseRequest; // Odd while the ring is downloaded, +1 at the start and at the end
+    std::atomic<uint32_t> PauseAck;     // PauseRequest seen by the last move, once it is over
+    std::atomic<bool> Enabled;          // Edges recorded by the interrupt
+} tRawCapture;
+
+// Called from the interrupt
+static inline __attribute__((always_inline)) void recordEdge(tRawCapture *c, uint32_t time)
+{
+    uint32_t Head = c->StagingHead.load(std::memory_order_relaxed);
+
+    if (Head - c->StagingTail.load(std::memory_order_acquire) >= RAW_STAGING_EDGES)
+    {
+        c->Lost.store(c->Lost.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return;
+    }
+
+    c->Staging[Head & (RAW_STAGING_EDGES - 1)] = time;
+    c->StagingHead.store(Head + 1, std::memory_order_release);
+}
+
+// Called from the decoding task : staging buffer emptied in the ring
+// Once PauseAck is the odd PauseRequest, the ring is not written any more until the next request
+void moveRawEdges(tRawCapture *c);
+
+// LEB128 of a delta - returns the # of bytes, 5 at most
+static inline int encodeDelta(uint8_t *out, uint32_t delta)
+{
+    int n = 0;
+
+    while (delta >= 0x80)
+    {
+        out[n++] = (delta & 0x7F) | 0x80;
+        delta >>= 7;
+    }
+    out[n++] = delta;
+
+    return n;
+}
+
+// Write the file of the edges kept in the ring, by blocks - the capture must be paused
+// Returns the # of bytes written
+typedef void (*tRawWrite)(const uint8_t *data, size_t length, void *context);
+size_t writeRawCapture(const tRawCapture *c, tRawWrite write, void *context);
+
+// Edges of a capture file - returns the # of edges, 0 if the file is not valid
+size_t decodeRawCapture(const uint8_t *data, size_t size, uint32_t *edges, size_t max);
+
+// # of edges given by the header, 0 if the file is not valid
+size_t rawCaptureCount(const uint8_t *data, size_t size);
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+// Single producer (interrupt) / single consumer (main loop) ring buffer of pulse durations
+// Indexes are free running and masked on access, so the size must be a power of 2
+#define PULSE_BUFFER_SIZE 256
+
+typedef struct
+{
+    uint16_t Delta[PULSE_BUFFER_SIZE]; // Duration between 2 bursts of carrier - us
+    std::atomic<uint32_t> Head;        // Only written by the producer
+    std::atomic<uint32_t> Tail;        // Only written by the consumer
+    std::atomic<uint32_t> Overflow;    // # of pulses dropped because the buffer was full
+} tPulseBuffer;
+
+// Called from the interrupt : never blocks, drops the pulse when the consumer is late
+static inline __attribute__((always_inline)) bool pushPulse(tPulseBuffer *b, uint16_t delta)
+{
+    uint32_t Head = b->Head.load(std::memory_order_relaxed);
+
+    if (Head - b->Tail.load(std::memory_order_acquire) >= PULSE_BUFFER_SIZE)
+    {
+        b->Overflow.store(b->Overflow.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return false;
+    }
+
+    b->Delta[Head & (PULSE_BUFFER_SIZE - 1)] = delta;
+    b->Head.store(Head + 1, std::memory_order_release);
+
+    return true;
+}
+
+// Called from the main loop : returns false when there is nothing to read
+static inline bool popPulse(tPulseBuffer *b, uint16_t *delta)
+{
+    uint32_t Tail = b->Tail.load(std::memory_order_relaxed);
+
+    if (Tail == b->Head.load(std::memory_order_acquire))
+        return false;
+
+    *delta = b->Delta[Tail & (PULSE_BUFFER_SIZE - 1)];
+    b->Tail.store(Tail + 1, std::memory_order_release);
+
+    return true;
+}
+
+// Drop everything that has been received but not read yet (consumer side only)
+static inline void flushPulses(tPulseBuffer *b)
+{
+    b->Tail.store(b->Head.load(std::memory_order_acquire), std::memory_order_release);
+}
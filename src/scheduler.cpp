@@ -0,0 +1,182 @@
+#include "scheduler.h"
+#include "metrics.h"
+
+static inline bool before(const tScheduler *s, int a, int b)
+{
+    return (int32_t)(s->Jobs[s->Heap[a]].Deadline - s->Jobs[s->Heap[b]].Deadline) < 0;
+}
+
+static inline void swapJobs(tScheduler *s, int a, int b)
+{
+    uint8_t Job = s->Heap[a];
+
+    s->Heap[a] = s->Heap[b];
+    s->Heap[b] = Job;
+    s->Jobs[s->Heap[a]].Position = a;
+    s->Jobs[s->Heap[b]].Position = b;
+}
+
+static void siftUp(tScheduler *s, int i)
+{
+    while ((i > 0) && before(s, i, (i - 1) / 2))
+    {
+        swapJobs(s, i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+static void siftDown(tScheduler *s, int i)
+{
+    while (true)
+    {
+        int Smallest = i;
+        int Left = 2 * i + 1;
+        int Right = Left + 1;
+
+        if ((Left < s->NbHeap) && before(s, Left, Smallest))
+            Smallest = Left;
+        if ((Right < s->NbHeap) && before(s, Right, Smallest))
+            Smallest = Right;
+        if (Smallest == i)
+            return;
+
+        swapJobs(s, i, Smallest);
+        i = Smallest;
+    }
+}
+
+static void removeJob(tScheduler *s, int job)
+{
+    int i = s->Jobs[job].Position;
+
+    if (i < 0)
+        return;
+
+    s->NbHeap--;
+    if (i != s->NbHeap)
+    {
+        swapJobs(s, i, s->NbHeap);
+        siftDown(s, i);
+        siftUp(s, i);
+    }
+
+    s->Jobs[job].Position = -1;
+}
+
+int addJob(tScheduler *s, const char *name, tJobFunction function, void *context, uint32_t now, uint32_t delay)
+{
+    if (s->NbJobs >= SCHEDULER_JOBS)
+        return -1;
+
+    int Job = s->NbJobs++;
+    tJob *j = &s->Jobs[Job];
+
+    *j = tJob();
+    j->Name = name;
+    j->Function = function;
+    j->Context = context;
+    j->Position = -1;
+
+    scheduleJob(s, Job, now, delay);
+    return Job;
+}
+
+void scheduleJob(tScheduler *s, int job, uint32_t now, uint32_t delay)
+{
+    removeJob(s, job);
+
+    s->Jobs[job].Deadline = now + delay;
+    s->Jobs[job].Position = s->NbHeap;
+    s->Heap[s->NbHeap] = job;
+    siftUp(s, s->NbHeap++);
+}
+
+void cancelJob(tScheduler *s, int job)
+{
+    removeJob(s, job);
+}
+
+int runJobs(tScheduler *s, uint32_t now)
+{
+    int Nb = 0;
+
+    // Each job runs once at most : a job late by more than its period does not run several times in a row
+    for (int n = s->NbHeap; (n > 0) && (s->NbHeap > 0); n--)
+    {
+        int Job = s->Heap[0];
+        tJob *j = &s->Jobs[Job];
+        uint32_t Jitter = now - j->Deadline;
+
+        if ((int32_t)Jitter < 0)
+            break;
+
+        removeJob(s, Job);
+
+        j->Runs++;
+        if (Jitter > j->MaxJitter)
+            j->MaxJitter = Jitter;
+        if (!j->Lazy)
+        {
+            s->Runs++;
+            s->JitterSum += Jitter;
+            if (Jitter > s->MaxJitter)
+                s->MaxJitter = Jitter;
+            observeMetric(histogramJitter, Jitter);
+        }
+
+        uint32_t Delay = j->Function(j->Context);
+        Nb++;
+
+        // Scheduled again or cancelled by the job itself
+        if ((j->Position >= 0) || (Delay == JOB_DONE))
+            continue;
+
+        // Late by more than the period : next run from now
+        uint32_t Deadline = j->Deadline + Delay;
+        scheduleJob(s, Job, ((int32_t)(Deadline - now) > 0) ? j->Deadline : now, Delay);
+    }
+
+    return Nb;
+}
+
+uint32_t nextJob(const tScheduler *s, uint32_t now)
+{
+    if (s->NbHeap == 0)
+        return SCHEDULER_MAX_WAIT;
+
+    int32_t Left = s->Jobs[s->Heap[0]].Deadline - now;
+
+    if (Left <= 0)
+        return 0;
+
+    return ((uint32_t)Left < SCHEDULER_MAX_WAIT) ? Left : SCHEDULER_MAX_WAIT;
+}
+
+uint32_t nextStrictJob(const tScheduler *s, uint32_t now)
+{
+    uint32_t Next = SCHEDULER_MAX_WAIT;
+
+    for (int i = 0; i < s->NbHeap; i++)
+    {
+        const tJob *j = &s->Jobs[s->Heap[i]];
+        int32_t Left = j->Deadline - now;
+
+        if (j->Lazy)
+            continue;
+        if (Left <= 0)
+            return 0;
+        if ((uint32_t)Left < Next)
+            Next = Left;
+    }
+
+    return Next;
+}
+
+void resetSchedulerStats(tScheduler *s, uint32_t now)
+{
+    s->StatsStart = now;
+    s->Runs = 0;
+    s->JitterSum = 0;
+    s->MaxJitter = 0;
+    s->Idle = 0;
+}
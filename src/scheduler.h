@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdint.h>
+
+// Jobs of loop() run at their deadline, kept in a min-heap of fixed capacity : no allocation
+// Between 2 deadlines loop() waits for a notification of the decoding task instead of spinning
+// Times are micros(), compared by their difference : the wrap after 71 min does not matter
+#define SCHEDULER_JOBS 16
+#define SCHEDULER_MAX_WAIT 1000000 // us - longest wait when no job is scheduled
+#define JOB_DONE 0                 // Returned by a job which must not run again
+
+// Returns the delay before the next run - us, or JOB_DONE
+typedef uint32_t (*tJobFunction)(void *context);
+
+typedef struct
+{
+    const char *Name;
+    tJobFunction Function;
+    void *Context;
+    uint32_t Deadline;  // us
+    int Position;       // In the heap, -1 when not scheduled
+    uint32_t Runs;
+    uint32_t MaxJitter; // us
+    bool Lazy;          // Can wait for the end of a light sleep, not counted in the jitter of the scheduler
+} tJob;
+
+typedef struct
+{
+    tJob Jobs[SCHEDULER_JOBS];
+    uint8_t Heap[SCHEDULER_JOBS]; // Jobs scheduled, the earliest deadline first
+    int NbHeap;
+    int NbJobs;
+
+    // Since the last reset of the statistics
+    uint32_t StatsStart;  // us
+    uint32_t Runs;
+    uint64_t JitterSum;   // us - from the deadline to the run
+    uint32_t MaxJitter;   // us
+    uint64_t Idle;        // us - added by loop() while it waits
+} tScheduler;
+
+// Job run at now + delay - returns its number, -1 when all the jobs are used
+int addJob(tScheduler *s, const char *name, tJobFunction function, void *context, uint32_t now, uint32_t delay);
+
+// Job run at now + delay, whether it was scheduled or not
+void scheduleJob(tScheduler *s, int job, uint32_t now, uint32_t delay);
+void cancelJob(tScheduler *s, int job);
+
+// Run the jobs whose deadline is reached - returns the # of jobs run
+// A periodic job keeps its rate : its next deadline follows the previous one, not the time it has run
+int runJobs(tScheduler *s, uint32_t now);
+
+// Time before the next deadline - us, 0 when late
+uint32_t nextJob(const tScheduler *s, uint32_t now);
+
+// Same, without the lazy jobs
+uint32_t nextStrictJob(const tScheduler *s, uint32_t now);
+
+void resetSchedulerStats(tScheduler *s, uint32_t now);
@@ -0,0 +1,50 @@
+#include <sys/time.h>
+#include "timekeeping.h"
+
+void initClock()
+{
+    if (clockNow() < CLOCK_VALID_TIME)
+        setClock(CLOCK_DEFAULT_TIME);
+}
+
+uint64_t clockNowUs()
+{
+    struct timeval Now;
+
+    gettimeofday(&Now, nullptr);
+    return (uint64_t)Now.tv_sec * 1000000 + Now.tv_usec;
+}
+
+time_t clockNow()
+{
+    return clockNowUs() / 1000000;
+}
+
+void setClock(time_t epoch)
+{
+    struct timeval Now = {.tv_sec = epoch, .tv_usec = 0};
+
+    settimeofday(&Now, nullptr);
+}
+
+void clockSleep(tClockStats *stats, uint64_t nowUs)
+{
+    stats->SleepStart = nowUs;
+}
+
+void clockWake(tClockStats *stats, uint64_t nowUs)
+{
+    // Reset instead of a wake up, or clock set backward : nothing to count
+    if ((stats->SleepStart == 0) || (nowUs < stats->SleepStart))
+    {
+        stats->SleepStart = 0;
+        return;
+    }
+
+    uint64_t Slept = nowUs - stats->SleepStart;
+
+    stats->Wakes++;
+    stats->Slept += Slept;
+    stats->AvoidedWakes += Slept / (OLD_WAKE_PERIOD * 1000000ULL);
+    stats->SleepStart = 0;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+
+// Time of the receiver : system clock of the ESP32, kept by the RTC timer during deep sleep
+// No wake up is needed to count the time asleep
+#define CLOCK_DEFAULT_TIME 1735689600 // 01/01/2025 - 00:00:00, until set by the web page
+#define CLOCK_VALID_TIME 1704067200   // Before 01/01/2024 the clock has never been set
+
+// Energy saved compared to the previous timer wake up every 5 s, only to count the time
+#define OLD_WAKE_PERIOD 5 // s
+#define WAKE_ENERGY 30    // mJ - estimate of a boot followed by deep sleep (~40 mA x 3.3 V x 230 ms)
+
+typedef struct
+{
+    uint32_t Wakes;        // # of wake up by the button
+    uint32_t AvoidedWakes; // # of timer wake up the previous version would have done
+    uint64_t SleepStart;   // us - 0 when awake
+    uint64_t Slept;        // us - total time in deep sleep
+} tClockStats;
+
+// First start : default time if the clock has never been set
+void initClock();
+
+time_t clockNow();
+uint64_t clockNowUs();
+void setClock(time_t epoch);
+
+// Time accounting around deep sleep
+void clockSleep(tClockStats *stats, uint64_t nowUs);
+void clockWake(tClockStats *stats, uint64_t nowUs);
+
+// mJ
+static inline uint32_t clockEnergySaved(const tClockStats *stats)
+{
+    return stats->AvoidedWakes * WAKE_ENERGY;
+}
@@ -0,0 +1,114 @@
+#include <stdio.h>
+#include "trace.h"
+#include "decoder.h"
+
+const uint8_t traceLevel[NB_TRACE_TYPES] = {
+    traceInfo,  // traceFrame
+    traceDebug, // traceBadFrame
+    traceDebug, // traceReject
+    traceError, // traceNoComm
+    traceError, // traceStats
+    traceError, // traceWindows
+    traceInfo,  // traceLogWritten
+    traceError, // traceLogRecovered
+    traceInfo,  // traceBoot
+    traceInfo,  // traceTasks
+    traceInfo,  // traceDisplay
+    traceInfo,  // traceClock
+    traceInfo,  // traceEvents
+    traceInfo,  // traceScheduler
+    traceInfo,  // traceBattery
+    traceError, // traceWebDropped
+    traceInfo,  // traceSleep
+};
+
+static const char *StatsName[2] = {"Stream", "Gap"};
+
+int formatTrace(const tTraceRecord *record, char *text, int size)
+{
+    const uint32_t *a = record->Args;
+    int Length = 0;
+
+    switch (record->Type)
+    {
+    case traceFrame:
+    case traceBadFrame:
+        Length = snprintf(text, size, "Time : %.1f, ID : %06u, Pressure : %d PSI - %.2f bars, Battery : %s, Checksum : %s\n",
+                          record->Time / 1e6, (unsigned)a[0], (int)a[1] * 2, a[1] * 2 / 14.504,
+                          batteryText((tBattery)a[2]), a[4] ? "corrected" : a[3] ? "OK" : "NOK");
+        break;
+
+    case traceReject:
+        Length = snprintf(text, size, "NOK %s %d\n", rejectText((tReject)a[0]), (int)a[1]);
+        break;
+
+    case traceNoComm:
+        Length = snprintf(text, size, "No more communication - %u pulses lost\n", (unsigned)a[0]);
+        break;
+
+    case traceStats:
+        Length = snprintf(text, size, "%s : %u OK (%u resync, %u recovered, %u retimed, %u corrected, %u refused), "
+                          "rejected : %u length, %u checksum, %u ID\n",
+                          StatsName[a[0] & 1], (unsigned)a[1], (unsigned)a[2], (unsigned)a[3], (unsigned)a[4],
+                          (unsigned)a[5], (unsigned)a[6], (unsigned)a[7], (unsigned)a[8], (unsigned)a[9]);
+        break;
+
+    case traceWindows:
+        Length = snprintf(text, size, "Windows : 0 = %u-%u us, 1 = %u-%u us\n",
+                          (unsigned)a[0], (unsigned)a[1], (unsigned)a[2], (unsigned)a[3]);
+        break;
+
+    case traceLogWritten:
+        Length = snprintf(text, size, "Log : %u readings written in %u us\n", (unsigned)a[0], (unsigned)a[1]);
+        break;
+
+    case traceBoot:
+        Length = snprintf(text, size, "Boot : capture %u us, serial %u us, display %u us, ready %u us after the start (setup at %u us)\n",
+                          (unsigned)a[0], (unsigned)a[1], (unsigned)a[2], (unsigned)a[3], (unsigned)record->Time);
+        break;
+
+    case traceLogRecovered:
+        Length = snprintf(text, size, "Log : %u bytes of a torn write removed\n", (unsigned)a[0]);
+        break;
+
+    case traceTasks:
+        Length = snprintf(text, size, "Tasks : decode stack free %u, max loop %u us, %u events lost - loop stack free %u, max loop %u us\n",
+                          (unsigned)a[0], (unsigned)a[1], (unsigned)a[2], (unsigned)a[3], (unsigned)a[4]);
+        break;
+
+    case traceDisplay:
+        Length = snprintf(text, size, "Display : %u bytes/s, %u us/s\n", (unsigned)a[0], (unsigned)a[1]);
+        break;
+
+    case traceClock:
+        Length = snprintf(text, size, "Clock : %u wake up, %u timer wake up avoided (~%u mJ), %u s asleep\n",
+                          (unsigned)a[0], (unsigned)a[1], (unsigned)a[2], (unsigned)a[3]);
+        break;
+
+    case traceEvents:
+        Length = snprintf(text, size, "Events : %u clients, %u frames delivered, %u lost, max latency %u us\n",
+                          (unsigned)a[0], (unsigned)a[1], (unsigned)a[2], (unsigned)a[3]);
+        break;
+
+    case traceScheduler:
+        Length = snprintf(text, size, "Scheduler : %u jobs run, jitter mean %u us max %u us, idle %.1f %%\n",
+                          (unsigned)a[0], (unsigned)a[1], (unsigned)a[2], a[3] / 10.0);
+        break;
+
+    case traceBattery:
+        Length = snprintf(text, size, "Battery : %.3f V, %u %%, %u min left, %u cycles/s\n",
+                          a[0] / 1000.0, (unsigned)a[1], (unsigned)a[2], (unsigned)a[3]);
+        break;
+
+    case traceWebDropped:
+        Length = snprintf(text, size, "Web : item of %u bytes not sent, longer than the chunk\n", (unsigned)a[0]);
+        break;
+
+    case traceSleep:
+        Length = snprintf(text, size, "Going to deep sleep\n");
+        break;
+    }
+
+    // Cut to the size of the buffer
+    return (Length < size) ? Length : size - 1;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+// Messages of the decoding path, written as binary records and sent as text by a low priority task
+// loop() adds a record without formatting nor waiting, a record is dropped when the ring is full
+// Single producer (loop) / single consumer (sending task), same as the pulse buffer
+#define TRACE_LENGTH 64  // Records, power of 2
+#define TRACE_TEXT 256   // Longest record once formatted
+#define TRACE_ARGS 10    // Values of a record
+
+typedef enum
+{
+    traceOff = 0,
+    traceError,  // No more communication, flash log recovered
+    traceInfo,   // Frames, flash log written
+    traceDebug,  // Bursts rejected
+} tTraceLevel;
+
+typedef enum
+{
+    traceFrame = 0,     // Time, ID, pressure, battery, checksum ok, corrected
+    traceBadFrame,      // Same as traceFrame, for a valid ID with a wrong checksum
+    traceReject,        // Reason, length
+    traceNoComm,        // Pauses lost
+    traceStats,         // Decoder (0 stream, 1 gap), accepted, resync, recovered, retimed, corrected, refused, rejected x 3
+    traceWindows,       // Min 0, max 0, min 1, max 1
+    traceLogWritten,    // Readings, duration - us
+    traceLogRecovered,  // Bytes removed
+    traceBoot,          // Capture, serial, display, ready - us since the start
+    traceTasks,         // Decode : stack free, max loop - us, events lost, loop : stack free, max loop - us
+    traceDisplay,       // Bytes/s, us/s
+    traceClock,         // Wakes, timer wakes avoided, energy saved - mJ, time asleep - s
+    traceEvents,        // Clients, delivered, lost, max latency - us
+    traceScheduler,     // Jobs run, mean jitter, max jitter - us, idle - 0.1 %
+    traceBattery,       // Voltage - mV, charge - %, runtime - min, cycles/s
+    traceWebDropped,    // Length of the item not sent - bytes
+    traceSleep,         // Going to deep sleep
+    NB_TRACE_TYPES,
+} tTraceType;
+
+typedef struct
+{
+    uint32_t Time; // us
+    uint32_t Type;
+    uint32_t Args[TRACE_ARGS];
+} tTraceRecord;
+
+typedef struct
+{
+    tTraceRecord Records[TRACE_LENGTH];
+    std::atomic<uint32_t> Head;    // Only written by the producer
+    std::atomic<uint32_t> Tail;    // Only written by the consumer
+    std::atomic<uint32_t> Dropped; // # of records lost because the ring was full
+    std::atomic<uint32_t> Unsent;  // # of records lost because the host did not read them
+    int Verbosity;                 // Records above this level are not added
+} tTraceRing;
+
+extern const uint8_t traceLevel[NB_TRACE_TYPES];
+
+// Slot for the next record, nullptr when it is filtered out or when the ring is full
+// The record is visible to the consumer only after commitTrace()
+static inline tTraceRecord *newTrace(tTraceRing *r, tTraceType type, uint32_t time)
+{
+    if (traceLevel[type] > r->Verbosity)
+        return nullptr;
+
+    uint32_t Head = r->Head.load(std::memory_order_relaxed);
+
+    if (Head - r->Tail.load(std::memory_order_acquire) >= TRACE_LENGTH)
+    {
+        r->Dropped.store(r->Dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    tTraceRecord *Record = &r->Records[Head & (TRACE_LENGTH - 1)];
+    Record->Time = time;
+    Record->Type = type;
+
+    return Record;
+}
+
+static inline void commitTrace(tTraceRing *r)
+{
+    r->Head.store(r->Head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+// Called by the consumer : returns false when there is nothing to read
+static inline bool popTrace(tTraceRing *r, tTraceRecord *record)
+{
+    uint32_t Tail = r->Tail.load(std::memory_order_relaxed);
+
+    if (Tail == r->Head.load(std::memory_order_acquire))
+        return false;
+
+    *record = r->Records[Tail & (TRACE_LENGTH - 1)];
+    r->Tail.store(Tail + 1, std::memory_order_release);
+
+    return true;
+}
+
+// Text of a record, same lines as the ones printed before - returns its length
+int formatTrace(const tTraceRecord *record, char *text, int size);
@@ -0,0 +1,159 @@
+#include "transmitters.h"
+
+static tTransmitter Transmitters[TRANSMITTER_SLOTS];
+static int NbTransmitters = 0;
+
+static inline int hashSlot(uint32_t id)
+{
+    // Fibonacci hashing on the 6 bits of the slot index
+    return (id * 2654435761u) >> 26;
+}
+
+static inline int nextSlot(int slot)
+{
+    return (slot + 1) & (TRANSMITTER_SLOTS - 1);
+}
+
+// Backward shift deletion : the following entries of the probe sequence are moved back
+// so that a lookup can always stop on the first free slot
+static void removeSlot(int slot)
+{
+    int Free = slot;
+
+    Transmitters[Free].Used = false;
+    NbTransmitters--;
+
+    for (int i = nextSlot(Free); Transmitters[i].Used; i = nextSlot(i))
+    {
+        int Home = hashSlot(Transmitters[i].Id);
+
+        // Entry can be moved if its home slot is not between the free slot and itself
+        if (((i - Home) & (TRANSMITTER_SLOTS - 1)) >= ((i - Free) & (TRANSMITTER_SLOTS - 1)))
+        {
+            Transmitters[Free] = Transmitters[i];
+            Transmitters[i].Used = false;
+            Free = i;
+        }
+    }
+}
+
+int transmitterSlot(uint32_t id)
+{
+    for (int i = hashSlot(id); Transmitters[i].Used; i = nextSlot(i))
+        if (Transmitters[i].Id == id)
+            return i;
+
+    return -1;
+}
+
+tTransmitter *findTransmitter(uint32_t id)
+{
+    return transmitterAt(transmitterSlot(id));
+}
+
+tTransmitter *updateTransmitter(const tFrame *frame, uint32_t now)
+{
+    tTransmitter *t = findTransmitter(frame->IdNumber);
+
+    if (t == nullptr)
+    {
+        // Table full : the oldest one is removed
+        if (NbTransmitters >= MAX_TRANSMITTERS)
+        {
+            int Oldest = -1;
+
+            for (int i = 0; i < TRANSMITTER_SLOTS; i++)
+                if (Transmitters[i].Used && ((Oldest < 0) || (now - Transmitters[i].LastSeen > now - Transmitters[Oldest].LastSeen)))
+                    Oldest = i;
+
+            removeSlot(Oldest);
+        }
+
+        int i = hashSlot(frame->IdNumber);
+        while (Transmitters[i].Used)
+            i = nextSlot(i);
+
+        t = &Transmitters[i];
+        *t = tTransmitter();
+        t->Used = true;
+        t->Id = frame->IdNumber;
+        NbTransmitters++;
+    }
+
+    t->Pressure = frame->Pressure;
+    t->Battery = frame->Battery;
+    t->Corrected = frame->Corrected;
+    t->LastSeen = now;
+    t->Frames++;
+
+    updateConsumption(&t->Consumption, frame->Pressure * 2 / 14.504f, now);
+    syncFrame(&t->Sync, now);
+
+    return t;
+}
+
+void countTransmitterError(uint32_t id)
+{
+    tTransmitter *t = findTransmitter(id);
+
+    if (t)
+        t->Errors++;
+}
+
+void evictStaleTransmitters(uint32_t now)
+{
+    // A removal can move the next entries back to this slot, so it is checked again
+    for (int i = 0; i < TRANSMITTER_SLOTS; i++)
+        while (Transmitters[i].Used && (now - Transmitters[i].LastSeen > TRANSMITTER_STALE_TIME))
+            removeSlot(i);
+}
+
+int nextTransmitter(int slot)
+{
+    for (int i = slot + 1; i < TRANSMITTER_SLOTS; i++)
+        if (Transmitters[i].Used)
+            return i;
+
+    return -1;
+}
+
+tTransmitter *transmitterAt(int slot)
+{
+    return ((slot >= 0) && (slot < TRANSMITTER_SLOTS) && Transmitters[slot].Used) ? &Transmitters[slot] : nullptr;
+}
+
+int nbTransmitters()
+{
+    return NbTransmitters;
+}
+
+int nextTank(uint32_t id, bool *pinned)
+{
+    int Slot = transmitterSlot(id);
+
+    if (Slot < 0)
+        *pinned = false;
+
+    // The tank displayed stays alone, or nothing else to display
+    if (*pinned || (NbTransmitters == 0) || ((NbTransmitters == 1) && (Slot >= 0)))
+        return -1;
+
+    Slot = nextTransmitter(Slot);
+    return (Slot < 0) ? nextTransmitter(-1) : Slot;
+}
+
+uint32_t transmittersSleepTime(uint32_t now)
+{
+    uint32_t Sleep = SYNC_FOREVER;
+
+    for (int i = 0; i < TRANSMITTER_SLOTS; i++)
+        if (Transmitters[i].Used)
+        {
+            uint32_t Time = frameSleepTime(&Transmitters[i].Sync, now);
+            if (Time < Sleep)
+                Sleep = Time;
+        }
+
+    // Nobody to wait for : listen
+    return (Sleep == SYNC_FOREVER) ? 0 : Sleep;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stdint.h>
+#include "decoder.h"
+#include "consumption.h"
+#include "framesync.h"
+
+// Table of the transmitters in range, indexed by their ID
+// Open addressing with linear probing : no allocation, O(1) lookup
+#define TRANSMITTER_SLOTS 64            // Power of 2
+#define MAX_TRANSMITTERS 32             // Half of the slots at most, so that the probes stay short
+#define TRANSMITTER_STALE_TIME 600000   // ms - removed after 10 min without any frame
+
+typedef struct
+{
+    bool Used;
+    uint32_t Id;       // 6 digits as an integer
+    int Pressure;      // Half of the pressure in PSI
+    tBattery Battery;
+    bool Corrected;    // Last frame corrected by the decoder : the pressure may be wrong
+    uint32_t LastSeen; // ms
+    uint32_t Frames;   // # of valid frames
+    uint32_t Errors;   // # of frames with this ID and a wrong checksum
+    tConsumption Consumption;
+    tFrameSync Sync;
+} tTransmitter;
+
+// Store the values of a valid frame - the oldest transmitter is evicted if the table is full
+tTransmitter *updateTransmitter(const tFrame *frame, uint32_t now);
+
+// Frame with a valid ID but a wrong checksum - only counted for a transmitter already known
+void countTransmitterError(uint32_t id);
+
+tTransmitter *findTransmitter(uint32_t id);
+
+// Slot of the transmitter, -1 if unknown - slots can change when a transmitter is removed
+int transmitterSlot(uint32_t id);
+
+// Remove the transmitters not seen for TRANSMITTER_STALE_TIME
+void evictStaleTransmitters(uint32_t now);
+
+// Slot of the next transmitter after the given slot (-1 to start), -1 when there is none
+int nextTransmitter(int slot);
+
+tTransmitter *transmitterAt(int slot);
+
+int nbTransmitters();
+
+// Slot of the tank to display after the one with the given ID, -1 to keep the one displayed
+// A pinned tank is kept while it is in the table, the pin is released once it has been removed
+int nextTank(uint32_t id, bool *pinned);
+
+// Time the receiver can sleep before the next frame of any transmitter - ms, 0 to listen
+uint32_t transmittersSleepTime(uint32_t now);
@@ -1,244 +1,473 @@
 #include <Arduino.h>
 #include "main.h"
 #include "web.h"
+#include "MH8A.h"
+#include "transmitters.h"
+#include "metrics.h"
+#include "capture.h"
+#include "events.h"
+#include "web_assets.h"
 #include <WiFi.h>
 #include <WebServer.h>
 #include <ESPmDNS.h>
 #include <ArduinoJson.h>
 #include <time.h>
-#include <sys/time.h>
+#include <stdarg.h>
 
 const char *ssid = "TankReader";
 const char *password = "12345678";
 
 WebServer server(80);
 
-void handleRoot()
-{
+// Browsers connected to /events
+#define EVENT_PING 15000 // ms - comment sent to detect the clients gone
 
-  String html = R"rawliteral(
-<!DOCTYPE html>
-<html>
-<head>
-  <meta charset='utf-8'>
-  <title>Tank pressure history</title>
-  <style>
-    body {
-      margin: 10px;
-      font-family: Arial, sans-serif;
-    }
+tEventRing eventRing;
+WiFiClient eventClients[EVENT_CLIENTS];
+unsigned long lastPing = 0;
 
-    .main-container {
-      display: flex;
-      flex-wrap: wrap;
-      justify-content: center;
-      gap: 20px;
-    }
-
-    .table-container {
-      flex: 1 1 600px;
-      max-width: 100%;
-    }
+// Page, script and style : compressed in flash at build time (see tools/embed_web.py)
+// sent without any copy, the browser keeps them until they change
+void handleAsset(const tWebAsset *asset)
+{
+  if (server.header("If-None-Match") == asset->ETag)
+  {
+    server.send(304);
+    return;
+  }
 
-    .form-container {
-      flex: 0 0 300px;
-      border: 1px solid #ccc;
-      padding: 10px;
-      border-radius: 10px;
-    }
+  server.sendHeader("Content-Encoding", "gzip");
+  server.sendHeader("ETag", asset->ETag);
 
-    table {
-      width: 100%;
-      max-width: 700px;
-      margin-left: auto;
-      margin-right: auto;
-      border-collapse: collapse;
-    }
+  // index.html must be checked each time, it gives the version of the other files in their URL
+  if (strcmp(asset->Path, "/") == 0)
+    server.sendHeader("Cache-Control", "no-cache");
+  else
+    server.sendHeader("Cache-Control", "public, max-age=31536000, immutable");
 
-    th, td {
-      border: 1px solid black;
-      padding: 8px;
-    }
+  server.send_P(200, asset->Type, (const char *)asset->Data, asset->Size);
+}
 
-    th {
-      background-color: #f2f2f2;
-    }
+// JSON (and the metrics) are streamed by chunks from a fixed buffer : no String, no heap
+#define JSON_CHUNK 512
 
-    th:first-child, td:first-child {
-      text-align: center;
-    }
+char jsonChunk[JSON_CHUNK];
+int jsonLength = 0;
 
-    input {
-      width: 60px;
-      margin: 4px;
-    }
+void jsonFlush(void)
+{
+  if (jsonLength > 0)
+    server.sendContent(jsonChunk, jsonLength);
+  jsonLength = 0;
+}
 
-    button {
-      margin: 6px;
-      padding: 5px 10px;
-    }
+void jsonPrintf(const char *format, ...)
+{
+  va_list args;
 
-    @media screen and (max-width: 768px) {
-      .main-container {
-        flex-direction: column;
-        align-items: center;
-      }
+  for (int retry = 0; retry < 2; retry++)
+  {
+    va_start(args, format);
+    int n = vsnprintf(jsonChunk + jsonLength, JSON_CHUNK - jsonLength, format, args);
+    va_end(args);
 
-      .form-container {
-        width: 100%;
-      }
-    }
-  </style>
-</head>
-<body>
-
-
-  <div class="main-container">
-    <!-- Tableau -->
-    <div class="table-container">
-      <h2 style="text-align:center;">History</h2>
-      <table id="dataTable">
-        <thead>
-          <tr><th>Num</th><th>Time</th><th>Id</th><th>Pressure</th><th>Battery</th></tr>
-        </thead>
-        <tbody></tbody>
-      </table>
-    </div>
-
-    <!-- Formulaire -->
-    <div class="form-container">
-      <h3>Time update</h3>
-      <div>
-        <label>Day:</label><input type="number" id="day" min="1" max="31"><br>
-        <label>Month:</label><input type="number" id="month" min="1" max="12"><br>
-        <label>Year:</label><input type="number" id="year" min="2024" max="2099"><br>
-        <label>Hours:</label><input type="number" id="hour" min="0" max="23"><br>
-        <label>Minutes:</label><input type="number" id="minute" min="0" max="59"><br>
-        <label>Secondes:</label><input type="number" id="second" min="0" max="59"><br>
-        <button onclick="fillWithBrowserTime()">Browser time</button>
-        <button onclick="sendDateTime()">Update</button>
-      </div>
-    </div>
-  </div>
-
-  <script>
-    function refreshTable() {
-      fetch("/data").then(r => r.json()).then(data => {
-        let tbody = document.querySelector("#dataTable tbody");
-        tbody.innerHTML = "";
-        data.forEach(row => {
-          let tr = document.createElement("tr");
-          tr.innerHTML =
-            `<td data-label="Num">${row.Num}</td>` +
-            `<td data-label="Time">${row.Time}</td>` +
-            `<td data-label="Id">${row.ID}</td>` +
-            `<td data-label="Pressure">${row.Pressure}</td>` +
-            `<td data-label="Battery">${row.Battery}</td>`;
-          tbody.appendChild(tr);
-        });
-      });
+    // Fits in what is left of the chunk
+    if ((n >= 0) && (n < JSON_CHUNK - jsonLength))
+    {
+      jsonLength += n;
+      return;
     }
 
-    function fillWithBrowserTime() {
-      const now = new Date();
-      document.getElementById("day").value = now.getDate();
-      document.getElementById("month").value = now.getMonth() + 1;
-      document.getElementById("year").value = now.getFullYear();
-      document.getElementById("hour").value = now.getHours();
-      document.getElementById("minute").value = now.getMinutes();
-      document.getElementById("second").value = now.getSeconds();
+    // Longer than the whole chunk : dropped, never sent truncated
+    if (jsonLength == 0)
+    {
+      countMetric(metricWebDropped);
+      Trace(traceWebDropped, micros(), {(uint32_t)n});
+      return;
     }
 
-    function sendDateTime() {
-      const payload = {
-        day: parseInt(document.getElementById("day").value),
-        month: parseInt(document.getElementById("month").value),
-        year: parseInt(document.getElementById("year").value),
-        hour: parseInt(document.getElementById("hour").value),
-        minute: parseInt(document.getElementById("minute").value),
-        second: parseInt(document.getElementById("second").value),
-      };
-
-      if (Object.values(payload).some(v => isNaN(v))) {
-        alert("Merci de remplir tous les champs correctement.");
-        return;
-      }
-
-      fetch("/set-time", {
-        method: "POST",
-        headers: { "Content-Type": "application/json" },
-        body: JSON.stringify(payload)
-      })
-      .then(r => r.text())
-      .then(msg => alert("Réponse ESP32 : " + msg))
-      .catch(err => alert("Erreur : " + err));
-    }
+    // Send the chunk and try again in the empty buffer
+    jsonFlush();
+  }
+}
 
-    setInterval(refreshTable, 2000);
-    refreshTable();
-  </script>
-</body>
-</html>
-)rawliteral";
-  server.send(200, "text/html", html);
+// Same JSON for a record in /data and in /events
+#define JSON_RECORD 160
+
+int formatRecord(char *buffer, int size, const tReading *r)
+{
+  struct tm t;
+  localtime_r(&r->Time, &t);
+
+  return snprintf(buffer, size, "{\"Num\":\"%u\",\"Time\":\"%02d/%02d/%02d - %02d:%02d:%02d\",\"ID\":\"%06u\","
+                  "\"Pressure\":\"%d PSI - %.2f bars\",\"Battery\":\"%s\",\"Corrected\":%s}",
+                  (unsigned)r->Num,
+                  t.tm_mday, t.tm_mon + 1, t.tm_year % 100,
+                  t.tm_hour, t.tm_min, t.tm_sec,
+                  (unsigned)r->Id, r->Pressure * 2, r->Pressure * 2 / 14.504, batteryText(r->Battery),
+                  r->Corrected ? "true" : "false");
 }
 
+// /data : records from the newest to the oldest
+// /data?since=<num> : only records newer than <num>
+// /data?id=123456 : only one transmitter
 void handleData()
 {
-  char tbuf[32];
+  // Newest record is the last one added : nothing to search
+  int last = (int)history.Count - 1;
+  int since = server.hasArg("since") ? server.arg("since").toInt() : -1;
+  bool filter = server.hasArg("id");
+  uint32_t id = filter ? server.arg("id").toInt() : 0;
+
+  // Same last record = same answer for a given URL
+  char etag[16];
+  snprintf(etag, sizeof(etag), "\"%d\"", last);
+
+  if (server.header("If-None-Match") == etag)
+  {
+    server.send(304);
+    return;
+  }
+
+  server.sendHeader("ETag", etag);
+  server.sendHeader("Cache-Control", "no-cache");
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, "application/json", "");
+
+  if (since < (int)historyOldest(&history) - 1)
+    since = (int)historyOldest(&history) - 1;
+
+  jsonLength = 0;
+  jsonPrintf("[");
 
-  int index = 0xff;
-  unsigned int maxNum = 0;
   bool first = true;
+  for (int num = last; num > since; num--)
+  {
+    tReading r;
+
+    if (!readHistory(&history, num, &r) || (filter && (r.Id != id)))
+      continue;
+
+    char record[JSON_RECORD];
+    formatRecord(record, sizeof(record), &r);
+
+    jsonPrintf("%s%s", first ? "" : ",", record);
+    first = false;
+  }
+
+  jsonPrintf("]");
+  jsonFlush();
+
+  // Empty chunk ends the answer
+  server.sendContent("");
+}
 
-  for (int i = 0; i < HISTORY_LENGTH; i++)
+// /tanks : transmitters in range with their consumption
+void handleTanks()
+{
+  server.sendHeader("Cache-Control", "no-cache");
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, "application/json", "");
+
+  jsonLength = 0;
+  jsonPrintf("{\"Reserve\":%.1f,\"Tanks\":[", reservePressure);
+
+  for (int slot = nextTransmitter(-1); slot >= 0; slot = nextTransmitter(slot))
   {
-    if (history[i].num > maxNum)
+    const tTransmitter *t = transmitterAt(slot);
+    float bar = t->Pressure * 2 / 14.504;
+
+    jsonPrintf("%s{\"ID\":\"%06u\",\"Pressure\":%.2f,\"Battery\":\"%s\",\"Rate\":%.2f,\"Trend\":%.2f,"
+               "\"ToReserve\":%.0f,\"Outliers\":%u,\"Frames\":%u,\"Errors\":%u}",
+               (slot == nextTransmitter(-1)) ? "" : ",", (unsigned)t->Id, bar, batteryText(t->Battery),
+               t->Consumption.Rate, t->Consumption.Trend, timeToReserve(&t->Consumption, bar, reservePressure),
+               (unsigned)t->Consumption.Outliers, (unsigned)t->Frames, (unsigned)t->Errors);
+  }
+
+  jsonPrintf("]}");
+  jsonFlush();
+  server.sendContent("");
+}
+
+// /set-reserve?bar=50 : pressure used for the time to reserve
+void handleSetReserve()
+{
+  float bar = server.arg("bar").toFloat();
+
+  if ((bar <= 0) || (bar > 300))
+  {
+    server.send(400, "text/plain", "Valeur invalide");
+    return;
+  }
+
+  reservePressure = bar;
+  server.send(200, "text/plain", "Réserve mise à jour");
+}
+
+// Level of the messages sent to the USB : 0 none, 1 errors, 2 frames, 3 rejected bursts
+void handleSetVerbosity()
+{
+  int level = server.arg("level").toInt();
+
+  if (!server.hasArg("level") || (level < traceOff) || (level > traceDebug))
+  {
+    server.send(400, "text/plain", "Valeur invalide");
+    return;
+  }
+
+  traceVerbosity = level;
+  traceRing.Verbosity = traceVerbosity;
+  server.send(200, "text/plain", "Niveau de log mis à jour");
+}
+
+// /metrics : counters and histograms in the Prometheus text format
+void handleMetrics()
+{
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, "text/plain; version=0.0.4", "");
+
+  jsonLength = 0;
+  exportMetrics(jsonPrintf);
+
+  // Kept during deep sleep, like the counters
+  printMetric(jsonPrintf, "mh8a_clock_wakes_total", "counter", "Wake up by the button");
+  jsonPrintf("mh8a_clock_wakes_total %u\n", (unsigned)clockStats.Wakes);
+  printMetric(jsonPrintf, "mh8a_clock_avoided_wakes_total", "counter", "Timer wake up the previous version would have done to count the time");
+  jsonPrintf("mh8a_clock_avoided_wakes_total %u\n", (unsigned)clockStats.AvoidedWakes);
+  printMetric(jsonPrintf, "mh8a_clock_energy_saved_mj_total", "counter", "Estimate of the energy saved by these wake up avoided");
+  jsonPrintf("mh8a_clock_energy_saved_mj_total %u\n", (unsigned)clockEnergySaved(&clockStats));
+
+  printMetric(jsonPrintf, "mh8a_tank_frames_total", "counter", "Valid frames by transmitter");
+  for (int slot = nextTransmitter(-1); slot >= 0; slot = nextTransmitter(slot))
+    jsonPrintf("mh8a_tank_frames_total{id=\"%06u\"} %u\n", (unsigned)transmitterAt(slot)->Id, (unsigned)transmitterAt(slot)->Frames);
+
+  printMetric(jsonPrintf, "mh8a_tank_errors_total", "counter", "Frames with a wrong checksum by transmitter");
+  for (int slot = nextTransmitter(-1); slot >= 0; slot = nextTransmitter(slot))
+    jsonPrintf("mh8a_tank_errors_total{id=\"%06u\"} %u\n", (unsigned)transmitterAt(slot)->Id, (unsigned)transmitterAt(slot)->Errors);
+
+  printMetric(jsonPrintf, "mh8a_capture_overflow_total", "counter", "Pauses dropped because the capture buffer was full");
+  jsonPrintf("mh8a_capture_overflow_total %u\n", (unsigned)captureOverflow());
+
+#if CAPTURE_BACKEND == CAPTURE_RMT
+  printMetric(jsonPrintf, "mh8a_capture_ring_full_total", "counter", "Batches read while the ring of the RMT driver was near full, some may have been dropped");
+  jsonPrintf("mh8a_capture_ring_full_total %u\n", (unsigned)captureRingFull());
+#endif
+
+  tRawCapture *capture = getRawCapture();
+  if (capture)
+  {
+    printMetric(jsonPrintf, "mh8a_capture_lost_total", "counter", "Edges not kept by the raw capture");
+    jsonPrintf("mh8a_capture_lost_total %u\n", (unsigned)capture->Lost.load());
+  }
+
+  printMetric(jsonPrintf, "mh8a_log_dropped_total", "counter", "Messages not sent to the USB, by reason");
+  jsonPrintf("mh8a_log_dropped_total{reason=\"full\"} %u\n", (unsigned)traceRing.Dropped.load());
+  jsonPrintf("mh8a_log_dropped_total{reason=\"usb\"} %u\n", (unsigned)traceRing.Unsent.load());
+
+  uint32_t elapsed = micros() - scheduler.StatsStart;
+  printMetric(jsonPrintf, "mh8a_idle_ratio", "gauge", "Part of the time loop() waits for its next job, since the last report");
+  jsonPrintf("mh8a_idle_ratio %.3f\n", elapsed ? (double)scheduler.Idle / elapsed : 0.0);
+
+  printMetric(jsonPrintf, "mh8a_battery_volts", "gauge", "Battery of the receiver, filtered");
+  jsonPrintf("mh8a_battery_volts %.3f\n", battery.Voltage);
+  printMetric(jsonPrintf, "mh8a_battery_charge_ratio", "gauge", "State of charge on the discharge curve of the cell");
+  jsonPrintf("mh8a_battery_charge_ratio %.3f\n", battery.Charge);
+  printMetric(jsonPrintf, "mh8a_battery_runtime_seconds", "gauge", "Runtime left at the current rate of discharge, 0 when not known");
+  jsonPrintf("mh8a_battery_runtime_seconds %u\n", (unsigned)batteryRuntime(&battery));
+
+  static const char *bootNames[NB_BOOT_PHASES] = {"setup", "capture", "serial", "display", "ready"};
+  printMetric(jsonPrintf, "mh8a_boot_us", "gauge", "Phases of the last boot, time since the start of the application");
+  for (int i = 0; i < NB_BOOT_PHASES; i++)
+    jsonPrintf("mh8a_boot_us{phase=\"%s\"} %u\n", bootNames[i], (unsigned)bootTimes[i]);
+
+  printMetric(jsonPrintf, "mh8a_heap_free_bytes", "gauge", "Free heap");
+  jsonPrintf("mh8a_heap_free_bytes %u\n", (unsigned)ESP.getFreeHeap());
+  printMetric(jsonPrintf, "mh8a_heap_min_free_bytes", "gauge", "Lowest free heap since the start");
+  jsonPrintf("mh8a_heap_min_free_bytes %u\n", (unsigned)ESP.getMinFreeHeap());
+  printMetric(jsonPrintf, "mh8a_loop_stack_free_bytes", "gauge", "Lowest free stack of loop()");
+  jsonPrintf("mh8a_loop_stack_free_bytes %u\n", (unsigned)uxTaskGetStackHighWaterMark(NULL));
+
+  jsonFlush();
+  server.sendContent("");
+}
+
+void writeChunk(const uint8_t *data, size_t length, void *)
+{
+  while (length > 0)
+  {
+    size_t n = JSON_CHUNK - jsonLength;
+    if (n > length)
+      n = length;
+
+    memcpy(jsonChunk + jsonLength, data, n);
+    jsonLength += n;
+    data += n;
+    length -= n;
+
+    if (jsonLength == JSON_CHUNK)
+      jsonFlush();
+  }
+}
+
+#define CAPTURE_PAUSE_TIMEOUT 100 // ms - the decoding task moves the edges at least once per tick
+
+// /capture.bin : last edges received, to be replayed on the host (see rawcapture.h)
+void handleCapture()
+{
+  tRawCapture *capture = getRawCapture();
+
+  if (capture == nullptr)
+  {
+    server.send(404, "text/plain", "Pas de capture");
+    return;
+  }
+
+  // The decoding task stops filling the ring while it is sent : its next move acknowledges the pause
+  uint32_t pause = capture->PauseRequest.fetch_add(1) + 1;
+  unsigned long start = millis();
+
+  while (capture->PauseAck.load() != pause)
+  {
+    if (millis() - start > CAPTURE_PAUSE_TIMEOUT)
     {
-      maxNum = history[i].num;
-      index = i;
+      capture->PauseRequest.fetch_add(1);
+      server.send(503, "text/plain", "Capture occupée");
+      return;
     }
+    delay(1);
   }
 
-  String json = "[";
-  for (int i = 0; i < HISTORY_LENGTH; ++i)
+  server.sendHeader("Content-Disposition", "attachment; filename=capture.bin");
+  server.sendHeader("Cache-Control", "no-cache");
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, "application/octet-stream", "");
+
+  jsonLength = 0;
+  writeRawCapture(capture, writeChunk, nullptr);
+  jsonFlush();
+  server.sendContent("");
+
+  capture->PauseRequest.fetch_add(1);
+}
+
+// POST /capture?on=1 : record the edges for /capture.bin, on=0 to stop (the interrupt is shorter)
+void handleSetCapture()
+{
+  tRawCapture *capture = getRawCapture();
+  int on = server.arg("on").toInt();
+
+  if (capture == nullptr)
   {
-    if (index < 0)
-      index = HISTORY_LENGTH - 1;
+    server.send(404, "text/plain", "Pas de capture");
+    return;
+  }
+  if (!server.hasArg("on") || (on < 0) || (on > 1))
+  {
+    server.send(400, "text/plain", "Valeur invalide");
+    return;
+  }
 
-    if (String(history[index].Battery) != "")
-    {
-      if (first)
-        first = false;
-      else
-        json += ",";
+  capture->Enabled.store(on == 1);
+  server.send(200, "text/plain", on ? "Capture active" : "Capture arrêtée");
+}
+
+void logRecord(const tReading *r, void *context)
+{
+  bool *first = (bool *)context;
+  char record[JSON_RECORD];
+
+  formatRecord(record, sizeof(record), r);
+  jsonPrintf("%s%s", *first ? "" : ",", record);
+  *first = false;
+}
 
-      json += "{";
-      json += "\"Num\":\"" + String(history[index].num) + "\",";
+// /log?from=<epoch>&to=<epoch>&id=123456 : readings saved in the flash, from the oldest to the newest
+// All the parameters are optional
+void handleLog()
+{
+  time_t from = server.hasArg("from") ? server.arg("from").toInt() : 0;
+  time_t to = server.hasArg("to") ? server.arg("to").toInt() : 0x7FFFFFFF;
+  uint32_t id = server.hasArg("id") ? server.arg("id").toInt() : 0;
 
-      snprintf(tbuf, sizeof(tbuf), "%02d/%02d/%02d - %02d:%02d:%02d",
-               history[index].time.tm_mday, history[index].time.tm_mon + 1, history[index].time.tm_year % 100,
-               history[index].time.tm_hour, history[index].time.tm_min, history[index].time.tm_sec);
-      String timeStr = String(tbuf);
+  // Readings still in RTC memory are written first
+  flushLog(true);
+  if (!mountLog())
+  {
+    server.send(500, "text/plain", "Pas de système de fichiers");
+    return;
+  }
 
-      json += "\"Time\":\"" + timeStr + "\",";
+  server.sendHeader("Cache-Control", "no-cache");
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, "application/json", "");
 
-      json += "\"ID\":\"" + String(history[index].ID) + "\",";
+  jsonLength = 0;
+  jsonPrintf("[");
 
-      snprintf(tbuf, sizeof(tbuf), "%d PSI - %.2f bars", history[index].Pressure * 2, history[index].Pressure * 2 / 14.504);
-      String pressureStr = String(tbuf);
+  bool first = true;
+  int read;
+  queryLog(&flashLog, from, to, id, logRecord, &first, &read);
 
-      json += "\"Pressure\":\"" + pressureStr + "\",";
+  jsonPrintf("]");
+  jsonFlush();
+  server.sendContent("");
+}
 
-      json += "\"Battery\":\"" + String(history[index].Battery) + "\"";
-      json += "}";
-    }
+// /events : the connection stays open, the records are pushed by loopWeb()
+void handleEvents()
+{
+  WiFiClient client = server.client();
 
-    index--;
+  int slot = addEventClient(&eventRing, client.fd());
+  if (slot < 0)
+  {
+    server.send(503, "text/plain", "Trop de clients");
+    return;
   }
-  json += "]";
 
-  server.send(200, "application/json", json);
+  client.print("HTTP/1.1 200 OK\r\n"
+               "Content-Type: text/event-stream\r\n"
+               "Cache-Control: no-cache\r\n"
+               "Connection: keep-alive\r\n\r\n"
+               "retry: 2000\n\n");
+
+  client.setNoDelay(true);
+
+  // Copy keeps the socket open once the server is done with the request
+  eventClients[slot] = client;
+}
+
+// Called by Decode() once per new record - never waits for the clients
+void publishWeb(uint32_t num, unsigned long time)
+{
+  tReading r;
+
+  if (!readHistory(&history, num, &r))
+    return;
+
+  char event[EVENT_LENGTH];
+  int length = snprintf(event, sizeof(event), "id: %u\ndata: ", (unsigned)num);
+
+  length += formatRecord(event + length, sizeof(event) - length, &r);
+  if (length > EVENT_LENGTH - 2)
+    return;
+
+  event[length++] = '\n';
+  event[length++] = '\n';
+
+  publishEvent(&eventRing, event, length, time);
+}
+
+void eventStats(unsigned *clients, unsigned long *delivered, unsigned long *dropped, unsigned long *maxLatency)
+{
+  *clients = 0;
+  for (int i = 0; i < EVENT_CLIENTS; i++)
+    *clients += eventRing.Client[i].Used;
+
+  *delivered = eventRing.Delivered;
+  *dropped = eventRing.Dropped;
+  *maxLatency = eventRing.MaxLatency;
+  eventRing.MaxLatency = 0;
 }
 
 void handleSetTime()
@@ -288,8 +517,6 @@ void handleSetTime()
     return;
   }
 
-  struct timeval now = {.tv_sec = epoch, .tv_usec = 0};
-  settimeofday(&now, nullptr);
   updateTime(epoch);
 
   server.send(200, "text/plain", "Heure mise à jour à " + String(asctime(&t)));
@@ -299,9 +526,26 @@ void initWeb(void)
 {
   WiFi.softAP(ssid, password);
 
-  server.on("/", handleRoot);
+  for (int i = 0; i < NB_WEB_ASSETS; i++)
+  {
+    const tWebAsset *asset = &webAssets[i];
+    server.on(asset->Path, HTTP_GET, [asset]() { handleAsset(asset); });
+  }
   server.on("/data", handleData);
+  server.on("/events", handleEvents);
+  server.on("/log", handleLog);
+  server.on("/tanks", handleTanks);
+  server.on("/metrics", handleMetrics);
+  server.on("/capture.bin", handleCapture);
+  server.on("/capture", HTTP_POST, handleSetCapture);
+  server.on("/set-reserve", HTTP_POST, handleSetReserve);
   server.on("/set-time", HTTP_POST, handleSetTime);
+  server.on("/set-verbosity", HTTP_POST, handleSetVerbosity);
+
+  // Needed to answer 304 when the browser already has the answer
+  const char *headers[] = {"If-None-Match"};
+  server.collectHeaders(headers, 1);
+
   server.begin();
 
   MDNS.begin("tankreader");
@@ -310,4 +554,17 @@ void initWeb(void)
 void loopWeb(void)
 {
   server.handleClient();
+
+  if (millis() - lastPing > EVENT_PING)
+  {
+    publishEvent(&eventRing, ":\n\n", 3, 0);
+    lastPing = millis();
+  }
+
+  pumpEvents(&eventRing, micros());
+
+  // Release the sockets of the clients gone
+  for (int i = 0; i < EVENT_CLIENTS; i++)
+    if (!eventRing.Client[i].Used && eventClients[i])
+      eventClients[i].stop();
 }
\ No newline at end of file
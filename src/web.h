@@ -1,7 +1,10 @@
 #pragma once
 
-extern RTC_DATA_ATTR tHistory history[100];
-extern RTC_DATA_ATTR int historyIndex;
+#include "history.h"
+
+extern RTC_NOINIT_ATTR tHistory history;
 
 extern void loopWeb();
+void publishWeb(uint32_t num, unsigned long time);
+void eventStats(unsigned *clients, unsigned long *delivered, unsigned long *dropped, unsigned long *maxLatency);
 void initWeb(void);
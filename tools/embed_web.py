@@ -0,0 +1,101 @@
+# Compress the web page sources (web/) into src/web_assets.h before each build
+#   extra_scripts = pre:tools/embed_web.py
+#   or python tools/embed_web.py
+#
+# Each file is stored gzip compressed in flash and sent as is with Content-Encoding: gzip
+# The ETag is a hash of the compressed file. style.css and app.js are referenced by index.html
+# with their ETag in the URL, so that they can be cached for ever by the browser
+
+import gzip
+import hashlib
+import os
+
+ASSETS = [
+    # Path, file, content type
+    ("/style.css", "style.css", "text/css"),
+    ("/app.js", "app.js", "application/javascript"),
+    ("/", "index.html", "text/html"),
+]
+
+try:
+    Import("env")
+    PROJECT_DIR = env["PROJECT_DIR"]
+except NameError:
+    PROJECT_DIR = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+WEB_DIR = os.path.join(PROJECT_DIR, "web")
+OUTPUT = os.path.join(PROJECT_DIR, "src", "web_assets.h")
+
+
+def compress(data):
+    # mtime = 0 : same sources, same bytes, same ETag
+    return gzip.compress(data, compresslevel=9, mtime=0)
+
+
+def embed():
+    etags = {}
+    arrays = []
+    table = []
+    raw_size = 0
+    gzip_size = 0
+
+    # index.html is done last, once the ETags of the files it references are known
+    for path, name, content_type in ASSETS:
+        with open(os.path.join(WEB_DIR, name), "rb") as f:
+            data = f.read()
+
+        if name == "index.html":
+            for other, etag in etags.items():
+                data = data.replace(('"%s"' % other).encode(), ('"%s?v=%s"' % (other, etag)).encode())
+
+        gz = compress(data)
+        etag = hashlib.sha256(gz).hexdigest()[:16]
+        etags[name] = etag
+
+        symbol = "web_" + name.replace(".", "_")
+        hexa = ",".join("0x%02x" % b for b in gz)
+        arrays.append("static const uint8_t %s[] PROGMEM = {%s};" % (symbol, hexa))
+        table.append('    {"%s", "%s", %s, sizeof(%s), "\\"%s\\""},' % (path, content_type, symbol, symbol, etag))
+
+        raw_size += len(data)
+        gzip_size += len(gz)
+        print("embed_web: %-12s %6d bytes -> %6d bytes gzip" % (name, len(data), len(gz)))
+
+    text = "\n".join([
+        "// Generated by tools/embed_web.py from web/ - do not edit",
+        "#pragma once",
+        "",
+        "#include <stdint.h>",
+        "",
+        "typedef struct",
+        "{",
+        "    const char *Path;",
+        "    const char *Type;",
+        "    const uint8_t *Data; // gzip",
+        "    size_t Size;",
+        "    const char *ETag;",
+        "} tWebAsset;",
+        "",
+    ] + arrays + [
+        "",
+        "static const tWebAsset webAssets[] = {",
+    ] + table + [
+        "};",
+        "",
+        "#define NB_WEB_ASSETS %d" % len(ASSETS),
+        "#define WEB_RAW_SIZE %d" % raw_size,
+        "#define WEB_GZIP_SIZE %d" % gzip_size,
+        "",
+    ])
+
+    # Only rewritten when it changes, so that web.cpp is not rebuilt each time
+    if os.path.exists(OUTPUT):
+        with open(OUTPUT) as f:
+            if f.read() == text:
+                return
+
+    with open(OUTPUT, "w") as f:
+        f.write(text)
+
+
+embed()
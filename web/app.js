@@ -0,0 +1,72 @@
+// Only ask for the records not displayed yet and add them on top
+let lastNum = -1;
+
+function addRow(row) {
+  if (parseInt(row.Num) <= lastNum)
+    return;
+  lastNum = parseInt(row.Num);
+
+  let tbody = document.querySelector("#dataTable tbody");
+  let tr = document.createElement("tr");
+  tr.innerHTML =
+    `<td data-label="Num">${row.Num}</td>` +
+    `<td data-label="Time">${row.Time}</td>` +
+    `<td data-label="Id">${row.ID}</td>` +
+    `<td data-label="Pressure">${row.Pressure}${row.Corrected ? " ~" : ""}</td>` +
+    `<td data-label="Battery">${row.Battery}</td>`;
+  tbody.insertBefore(tr, tbody.firstChild);
+}
+
+function refreshTable() {
+  fetch(`/data?since=${lastNum}`).then(r => r.json()).then(data => {
+    data.reverse().forEach(addRow);
+  });
+}
+
+// New records are pushed by the ESP32, /data is only read again when some have been missed
+let events = new EventSource("/events");
+events.onopen = refreshTable;
+events.onmessage = e => {
+  let row = JSON.parse(e.data);
+  if (parseInt(row.Num) > lastNum + 1)
+    refreshTable();
+  else
+    addRow(row);
+};
+
+function fillWithBrowserTime() {
+  const now = new Date();
+  document.getElementById("day").value = now.getDate();
+  document.getElementById("month").value = now.getMonth() + 1;
+  document.getElementById("year").value = now.getFullYear();
+  document.getElementById("hour").value = now.getHours();
+  document.getElementById("minute").value = now.getMinutes();
+  document.getElementById("second").value = now.getSeconds();
+}
+
+function sendDateTime() {
+  const payload = {
+    day: parseInt(document.getElementById("day").value),
+    month: parseInt(document.getElementById("month").value),
+    year: parseInt(document.getElementById("year").value),
+    hour: parseInt(document.getElementById("hour").value),
+    minute: parseInt(document.getElementById("minute").value),
+    second: parseInt(document.getElementById("second").value),
+  };
+
+  if (Object.values(payload).some(v => isNaN(v))) {
+    alert("Merci de remplir tous les champs correctement.");
+    return;
+  }
+
+  fetch("/set-time", {
+    method: "POST",
+    headers: { "Content-Type": "application/json" },
+    body: JSON.stringify(payload)
+  })
+  .then(r => r.text())
+  .then(msg => alert("Réponse ESP32 : " + msg))
+  .catch(err => alert("Erreur : " + err));
+}
+
+refreshTable();